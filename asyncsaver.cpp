@@ -0,0 +1,147 @@
+#include "asyncsaver.h"
+#include "trace.h"
+
+#include <QFileInfo>
+#include <QSet>
+#include <QTemporaryFile>
+
+#include <memory>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+AsyncSaver::AsyncSaver(QObject *parent) : QObject(parent),
+    pending(0)
+{
+    pool.setMaxThreadCount(1);
+    pool.setExpiryTimeout(-1);
+}
+
+AsyncSaver::~AsyncSaver()
+{
+    pool.waitForDone();
+}
+
+void AsyncSaver::save(const QVector<SaveJob> &jobs)
+{
+    if (jobs.isEmpty())
+        return;
+    ++pending;
+    pool.start([this, jobs] {
+        run(jobs);
+        QMetaObject::invokeMethod(this, [this] {
+            if (--pending == 0)
+                emit idle();
+        }, Qt::QueuedConnection);
+    });
+}
+
+static bool syncFile(int handle)
+{
+#ifdef Q_OS_UNIX
+    return ::fsync(handle) == 0;
+#else
+    Q_UNUSED(handle);
+    return true;
+#endif
+}
+
+static bool syncDirectory(const QString &path)
+{
+#ifdef Q_OS_UNIX
+    int handle = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY);
+    if (handle < 0)
+        return false;
+    bool ok = ::fsync(handle) == 0;
+    ::close(handle);
+    return ok;
+#else
+    Q_UNUSED(path);
+    return true;
+#endif
+}
+
+/* Replaces target with source, atomically where the system allows. */
+static bool replaceFile(const QString &source, const QString &target)
+{
+#ifdef Q_OS_UNIX
+    return ::rename(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0;
+#else
+    QFile::remove(target);
+    return QFile::rename(source, target);
+#endif
+}
+
+void AsyncSaver::run(const QVector<SaveJob> &jobs)
+{
+    TraceSpan span("io", "saveBatch");
+    span.arg("files", jobs.size());
+
+    struct Result
+    {
+        QString target; // where a symlink points, so that it survives
+        std::unique_ptr<QTemporaryFile> file;
+        QString error;
+    };
+    std::vector<Result> results(size_t(jobs.size()));
+
+    /* write everything first... */
+    for (int i = 0; i < jobs.size(); ++i) {
+        Result &result = results[size_t(i)];
+        QFileInfo info(jobs.at(i).fileName);
+        result.target = info.isSymLink() ? info.symLinkTarget() : info.absoluteFilePath();
+        QFileInfo target(result.target);
+
+        result.file.reset(new QTemporaryFile(target.absolutePath() + "/." + target.fileName() + ".XXXXXX"));
+        QTemporaryFile *file = result.file.get();
+        if (!file->open()) {
+            result.error = file->errorString();
+            continue;
+        }
+        if (target.exists())
+            file->setPermissions(target.permissions());
+        else
+            file->setPermissions(QFile::ReadOwner | QFile::WriteOwner | QFile::ReadGroup | QFile::ReadOther);
+
+        TraceSpan writeSpan("io", "writeTemporary");
+        if (!jobs.at(i).write(file) || !file->flush())
+            result.error = file->errorString();
+        writeSpan.arg("bytes", file->size());
+    }
+
+    /* ...then sync it all, so that the syncs can share disk commits */
+    {
+        TraceSpan syncSpan("io", "fsync");
+        for (Result &result : results) {
+            if (result.error.isEmpty() && !syncFile(result.file->handle()))
+                result.error = QStringLiteral("Could not sync to disk");
+        }
+    }
+
+    QSet<QString> directories;
+    for (Result &result : results) {
+        if (!result.error.isEmpty())
+            continue;
+        result.file->close();
+        if (replaceFile(result.file->fileName(), result.target)) {
+            result.file->setAutoRemove(false);
+            directories.insert(QFileInfo(result.target).absolutePath());
+        } else {
+            result.error = QStringLiteral("Could not replace the file");
+        }
+    }
+    /* the renames themselves are only durable once their directory is */
+    for (const QString &directory : directories)
+        syncDirectory(directory);
+
+    for (int i = 0; i < jobs.size(); ++i) {
+        if (results[size_t(i)].error.isEmpty())
+            emit saved(jobs.at(i).fileName, jobs.at(i).revision);
+        else
+            emit failed(jobs.at(i).fileName, jobs.at(i).revision, results[size_t(i)].error);
+    }
+}
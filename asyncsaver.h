@@ -0,0 +1,53 @@
+#ifndef ASYNCSAVER_H
+#define ASYNCSAVER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+/* Writes the whole text of a document to a device. It is called on the
+   saving thread, so it must only use a snapshot of the document. */
+typedef std::function<bool(QIODevice *device)> SaveFunction;
+
+struct SaveJob
+{
+    QString fileName;
+    SaveFunction write;
+    int revision; // of the document written, handed back when it is done
+};
+
+/* Saves documents on a background thread, never in place: each file is
+   written to a temporary file beside it, synced, and renamed over the
+   original, so a crash leaves either the old or the new file. A batch
+   writes all its files before syncing any, so the disk can commit them
+   together. Batches are saved one after the other. */
+class AsyncSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AsyncSaver(QObject *parent = nullptr);
+    ~AsyncSaver();
+
+    void save(const QVector<SaveJob> &jobs);
+    bool isSaving() const { return pending > 0; }
+
+signals:
+    void saved(const QString &fileName, int revision);
+    void failed(const QString &fileName, int revision, const QString &error);
+    void idle();
+
+private:
+    void run(const QVector<SaveJob> &jobs);
+
+    QThreadPool pool;
+    int pending; // batches not finished yet
+};
+
+#endif
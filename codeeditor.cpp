@@ -2,35 +2,296 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR BSD-3-Clause
 
 #include "codeeditor.h"
+#include "textwriter.h"
+#include "trace.h"
 
 #include <QPainter>
+#include <QPlainTextDocumentLayout>
+#include <QScrollBar>
 #include <QTextBlock>
+#include <QTextLayout>
+#include <QTimer>
+
+// What Qt keeps for each block besides its text: fragment, format and layout objects.
+static const int blockOverhead = 160;
+// A laid-out line of a block.
+static const int lineOverhead = 64;
+
+// Traces the relayout of the blocks touched by each contents change.
+class TracingDocumentLayout : public QPlainTextDocumentLayout
+{
+public:
+    TracingDocumentLayout(QTextDocument *document) : QPlainTextDocumentLayout(document) {}
+
+protected:
+    void documentChanged(int from, int charsRemoved, int charsAdded) override
+    {
+        TraceSpan span("layout", "documentChanged");
+        span.arg("from", from);
+        span.arg("length", charsAdded);
+        QPlainTextDocumentLayout::documentChanged(from, charsRemoved, charsAdded);
+    }
+};
 
 //![constructor]
 
-CodeEditor::CodeEditor(QFont font, QWidget *parent) : QPlainTextEdit(parent)
+CodeEditor::CodeEditor(QFont font, QWidget *parent) : QPlainTextEdit(parent),
+    lineNumbersEnabled(true),
+    highlighter(nullptr),
+    owner(this),
+    visibleTimer(new QTimer(this)),
+    encoding(TextEncoding::Utf8),
+    bom(false),
+    endings(LineEndings::Lf),
+    compression(Compression::None),
+    lastRevision(0)
 {
-    lineNumberArea = new LineNumberArea(this);
     QTextDocument *document = this->document();
-    QTextCursor documentEnd(document);
-    documentEnd.movePosition(QTextCursor::End);
-    highlighter = new Highlighter(document, "html", QTextCursor(document), QTextCursor(document), false, false, false, 180);
+    if (Trace::isEnabled())
+        document->setDocumentLayout(new TracingDocumentLayout(document));
+    setLanguage("html");
 	
 	document->setDefaultFont(font);
 
+    visibleTimer->setSingleShot(true);
+    connect(visibleTimer, &QTimer::timeout, this, &CodeEditor::highlightVisibleBlocks);
+    connect(document, &QTextDocument::contentsChange, this, &CodeEditor::contentsChange);
+
+    initView();
+}
+
+CodeEditor::CodeEditor(CodeEditor *editor, QWidget *parent) : QPlainTextEdit(parent),
+    lineNumbersEnabled(editor->lineNumbersEnabled),
+    highlighter(nullptr),
+    owner(editor),
+    visibleTimer(nullptr),
+    encoding(editor->encoding),
+    bom(editor->bom),
+    endings(editor->endings),
+    compression(editor->compression),
+    lastRevision(0)
+{
+    /* the layout is shared too: both views have to be as wide, as in
+       a split into top and bottom */
+    setDocument(editor->document());
+    editor->splits.append(this);
+    initView();
+}
+
+CodeEditor::~CodeEditor()
+{
+    if (owner != this) {
+        if (owner->splits.removeOne(this))
+            owner->highlightVisibleBlocks();
+        return;
+    }
+    /* the views of the document go with it */
+    const QList<CodeEditor *> views = splits;
+    splits.clear();
+    qDeleteAll(views);
+}
+
+void CodeEditor::initView()
+{
+    lineNumberArea = new LineNumberArea(this, this);
+
     connect(this, &CodeEditor::blockCountChanged, this, &CodeEditor::updateLineNumberAreaWidth);
     connect(this, &CodeEditor::updateRequest, this, &CodeEditor::updateLineNumberArea);
     connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::highlightCurrentLine);
-    /*connect(this, &CodeEditor::updateRequest, highlighter, [this, document]{
-        QTextCursor documentEnd2(document);
-        documentEnd2.movePosition(QTextCursor::End);
-        highlighter->setLimit(this->textCursor(), this->textCursor());
-    });*/
+    /* at once, so that the blocks scrolled into view are formatted before
+       they are painted */
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &CodeEditor::highlightVisibleBlocks);
 
     updateLineNumberAreaWidth(0);
     highlightCurrentLine();
 }
 
+void CodeEditor::setLanguage(const QString &lang)
+{
+    if (owner != this) {
+        owner->setLanguage(lang);
+        return;
+    }
+    delete highlighter;
+    QTextDocument *document = this->document();
+    highlighter = new Highlighter(document, lang, QTextCursor(document), QTextCursor(document), false, false, false, 180);
+    highlighter->setLimits(visibleRanges());
+}
+
+QPair<QTextCursor, QTextCursor> CodeEditor::visibleRange() const
+{
+    return qMakePair(QTextCursor(firstVisibleBlock()), cursorForPosition(QPoint(0, viewport()->height() - 1)));
+}
+
+QVector<QPair<QTextCursor, QTextCursor> > CodeEditor::visibleRanges() const
+{
+    QVector<QPair<QTextCursor, QTextCursor> > ranges;
+    ranges.append(visibleRange());
+    for (const CodeEditor *split : splits)
+        ranges.append(split->visibleRange());
+    return ranges;
+}
+
+void CodeEditor::highlightVisibleBlocks()
+{
+    if (owner != this) {
+        owner->highlightVisibleBlocks();
+        return;
+    }
+    TraceSpan span("highlight", "highlightVisibleBlocks");
+    const QVector<QPair<QTextCursor, QTextCursor> > ranges = visibleRanges();
+    highlighter->setLimits(ranges);
+
+    /* Blocks out of view only got the state that the blocks after them
+       need; they are formatted once a view shows them, and only once
+       when several views do. Blocks the highlighter has not been to at
+       all are left to its pending pass. */
+    int formatted = 0;
+    for (const QPair<QTextCursor, QTextCursor> &range : ranges) {
+        const QTextBlock end = range.second.block().next();
+        for (QTextBlock block = range.first.block(); block.isValid() && block != end; block = block.next()) {
+            const TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+            if (!data || data->isHighlighted())
+                continue;
+            highlighter->rehighlightBlock(block);
+            ++formatted;
+        }
+    }
+    span.arg("blocks", formatted);
+}
+
+void CodeEditor::setFileFormat(TextEncoding::Encoding encoding, bool bom, LineEndings::Style style)
+{
+    this->encoding = encoding;
+    this->bom = bom;
+    endings = style;
+}
+
+SaveFunction CodeEditor::snapshot() const
+{
+    TraceSpan span("io", "snapshot");
+    /* the raw text keeps non-breaking spaces; blocks are separated by
+       paragraph separators in it */
+    const QString text = document()->toRawText();
+    const TextEncoding::Encoding encoding = this->encoding;
+    const bool bom = this->bom;
+    const LineEndings::Style style = endings;
+    return Compression::compressing(compression, [text, encoding, bom, style](QIODevice *device) {
+        TextWriter writer(device, encoding, style, bom);
+        writer.writeLines(text, QChar::ParagraphSeparator);
+        return writer.finish();
+    });
+}
+
+int CodeEditor::revision() const
+{
+    return document()->revision();
+}
+
+void CodeEditor::markSaved(int revision)
+{
+    if (document()->revision() == revision)
+        document()->setModified(false);
+}
+
+void CodeEditor::contentsChange(int position, int removed, int added)
+{
+    /* the highlighter reports its formats as changes of the same
+       length, which leave the revision alone */
+    QTextDocument *document = this->document();
+    if (document->revision() == lastRevision)
+        return;
+    lastRevision = document->revision();
+    visibleTimer->start();
+    if (!receivers(SIGNAL(edited(qint64,qint64,QByteArray))))
+        return;
+
+    /* The counts may include the final paragraph separator, which
+       can neither be removed nor inserted; applyEdit() clamps them. */
+    int end = qMin(position + added, document->characterCount() - 1);
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(qMax(position, end), QTextCursor::KeepAnchor);
+    QString text = cursor.selectedText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    emit edited(position, removed, TextEncoding::encode(text, TextEncoding::Utf8));
+}
+
+void CodeEditor::applyEdit(qint64 position, qint64 removed, const QByteArray &inserted)
+{
+    const int last = document()->characterCount() - 1;
+    QTextCursor cursor(document());
+    cursor.setPosition(int(qMin<qint64>(position, last)));
+    cursor.setPosition(int(qMin<qint64>(position + removed, last)), QTextCursor::KeepAnchor);
+    cursor.insertText(TextEncoding::decode(inserted.constData(), inserted.size(), TextEncoding::Utf8));
+}
+
+qint64 CodeEditor::memoryUsage() const
+{
+    TraceSpan span("memory", "editorUsage");
+    qint64 bytes = 0;
+    for (QTextBlock block = document()->begin(); block.isValid(); block = block.next()) {
+        bytes += block.length() * qint64(sizeof(QChar)) + blockOverhead;
+        const QTextLayout *layout = block.layout();
+        bytes += layout->lineCount() * lineOverhead;
+        bytes += layout->formats().size() * qint64(sizeof(QTextLayout::FormatRange));
+        if (block.userData())
+            bytes += sizeof(TextBlockData);
+    }
+    span.arg("bytes", bytes);
+    return bytes;
+}
+
+void CodeEditor::goToLine(int line, int column)
+{
+    TraceSpan span("app", "goToLine");
+    span.arg("line", line);
+    /* findBlockByNumber() walks the block tree, not the blocks */
+    QTextDocument *document = this->document();
+    const QTextBlock block = document->findBlockByNumber(qBound(0, line, document->blockCount() - 1));
+    QTextCursor cursor(block);
+    cursor.setPosition(block.position() + qBound(0, column, block.length() - 1));
+    /* each scroll formats the blocks it brings into view at once, so
+       the target is highlighted by the time it is painted */
+    setTextCursor(cursor);
+    centerCursor();
+}
+
+LineSnapshot CodeEditor::lineSnapshot() const
+{
+    TraceSpan span("app", "lineSnapshot");
+    const QString text = document()->toRawText();
+    return [text](const LineVisitor &visit) {
+        int start = 0;
+        for (;;) {
+            int end = text.indexOf(QChar::ParagraphSeparator, start);
+            if (!visit(text.mid(start, end < 0 ? -1 : end - start)) || end < 0)
+                return;
+            start = end + 1;
+        }
+    };
+}
+
+bool CodeEditor::findMatch(const QRegularExpression &expression, MatchCounter::Jump jump)
+{
+    TraceSpan span("app", "findMatch");
+    QTextCursor cursor = textCursor();
+    QTextDocument::FindFlags flags;
+    if (jump == MatchCounter::Previous)
+        flags |= QTextDocument::FindBackward;
+    else if (jump == MatchCounter::NoJump)
+        cursor.setPosition(cursor.selectionStart()); // a longer search still matches there
+    QTextCursor match = document()->find(expression, cursor, flags);
+    if (match.isNull()) {
+        cursor.movePosition(jump == MatchCounter::Previous ? QTextCursor::End : QTextCursor::Start);
+        match = document()->find(expression, cursor, flags);
+    }
+    if (match.isNull())
+        return false;
+    setTextCursor(match);
+    return true;
+}
+
 void CodeEditor::disableLineNumbers(bool b){
 	this->lineNumbersEnabled = !b;
 	updateLineNumberAreaWidth(lineNumberAreaWidth());
@@ -86,6 +347,7 @@ void CodeEditor::resizeEvent(QResizeEvent *e)
 
     QRect cr = contentsRect();
     lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    highlightVisibleBlocks();
 }
 
 //![resizeEvent]
@@ -113,8 +375,19 @@ void CodeEditor::highlightCurrentLine()
 
 //![extraAreaPaintEvent_0]
 
+void CodeEditor::paintEvent(QPaintEvent *event)
+{
+    TraceSpan span("paint", "paintEvent");
+    if (span.isActive())
+        span.arg("firstBlock", firstVisibleBlock().blockNumber());
+    QPlainTextEdit::paintEvent(event);
+}
+
 void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
 {
+    TraceSpan span("paint", "lineNumberAreaPaintEvent");
+    if (span.isActive())
+        span.arg("firstBlock", firstVisibleBlock().blockNumber());
     QPainter painter(lineNumberArea);
     painter.fillRect(event->rect(), QApplication::palette().alternateBase());
 
@@ -6,44 +6,126 @@
 
 #include <QPlainTextEdit>
 #include <QApplication>
+#include "asyncsaver.h"
+#include "compression.h"
 #include "highlighter/highlighter.h"
+#include "lineendings.h"
+#include "matchcounter.h"
+#include "textencoding.h"
 
 QT_BEGIN_NAMESPACE
 class QPaintEvent;
 class QResizeEvent;
 class QSize;
+class QTimer;
 class QWidget;
 QT_END_NAMESPACE
 
 class LineNumberArea;
 
+// A widget that shows a LineNumberArea next to its text.
+class LineNumberHost
+{
+public:
+    virtual ~LineNumberHost() {}
+    virtual void lineNumberAreaPaintEvent(QPaintEvent *event) = 0;
+    virtual int lineNumberAreaWidth() = 0;
+};
+
 //![codeeditordefinition]
 
-class CodeEditor : public QPlainTextEdit
+class CodeEditor : public QPlainTextEdit, public LineNumberHost
 {
     Q_OBJECT
 
 public:
     CodeEditor(QFont font, QWidget *parent = nullptr);
-
-    void lineNumberAreaPaintEvent(QPaintEvent *event);
-    int lineNumberAreaWidth();
+    /* Another view of the document of editor, as in a split window. The
+       text, its layout and its highlighting are shared, so the view
+       costs no more memory than its widgets. It goes with editor. */
+    CodeEditor(CodeEditor *editor, QWidget *parent = nullptr);
+    ~CodeEditor();
+
+    void lineNumberAreaPaintEvent(QPaintEvent *event) override;
+    int lineNumberAreaWidth() override;
+
+    void setLanguage(const QString &lang);
+
+    /* How the text is written back: the document itself only has
+       blocks, so the encoding and line endings of the file are kept
+       here. */
+    void setFileFormat(TextEncoding::Encoding encoding, bool bom, LineEndings::Style style);
+    void setLineEndingStyle(LineEndings::Style style) { endings = style; }
+    LineEndings::Style lineEndingStyle() const { return endings; }
+    TextEncoding::Encoding textEncoding() const { return encoding; }
+    /* The file is compressed again when it is saved, unless this is
+       set to None. */
+    void setCompression(Compression::Format format) { compression = format; }
+    Compression::Format compressionFormat() const { return compression; }
+
+    QString fileName() const { return path; }
+    void setFileName(const QString &fileName) { path = fileName; }
+    /* Takes a copy of the text for saving; the editor can go on being
+       edited while it is written. QTextDocument has no copy-on-write
+       snapshot, so the copy itself is made on the calling thread, in
+       time that grows with the document. */
+    SaveFunction snapshot() const;
+    /* Clears the modified flag, unless the text was edited since the
+       snapshot that was saved. */
+    void markSaved(int revision);
+    int revision() const;
+    /* Replaces removed characters at position, for replaying a journal. */
+    void applyEdit(qint64 position, qint64 removed, const QByteArray &inserted);
+    /* A rough count of the bytes the document holds: its text and the
+       layout and highlighting of each block. The undo history is not
+       counted. */
+    qint64 memoryUsage() const;
+    /* Moves the cursor to a line and column, counted from 0 and clamped
+       to the text, and shows it in the middle of the view. */
+    void goToLine(int line, int column);
+    /* Takes a copy of the text for counting matches on another thread. */
+    LineSnapshot lineSnapshot() const;
+    /* Selects the match at or after the start of the selection, or with
+       jump, the next or the previous one, wrapping around. */
+    bool findMatch(const QRegularExpression &expression, MatchCounter::Jump jump);
 
 public slots:
 	void disableLineNumbers(bool b);
 
+signals:
+    /* Each change of the text, with the inserted text in UTF-8 and line
+       breaks as '\n'. Changes of the highlighting are left out. */
+    void edited(qint64 position, qint64 removed, const QByteArray &inserted);
+
 protected:
     void resizeEvent(QResizeEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
 
 private slots:
     void updateLineNumberAreaWidth(int newBlockCount);
     void highlightCurrentLine();
     void updateLineNumberArea(const QRect &rect, int dy);
+    void contentsChange(int position, int removed, int added);
+    void highlightVisibleBlocks();
 
 private:
+    void initView();
+    QPair<QTextCursor, QTextCursor> visibleRange() const;
+    /* Of this view and its splits, for the editor that owns the document. */
+    QVector<QPair<QTextCursor, QTextCursor> > visibleRanges() const;
+
     QWidget *lineNumberArea;
 	bool lineNumbersEnabled;
-    Highlighter *highlighter;
+    Highlighter *highlighter; // of the editor that owns the document
+    CodeEditor *owner; // the editor whose document this view shows, or this
+    QList<CodeEditor *> splits; // other views of the document
+    QTimer *visibleTimer; // highlights what edits brought into view
+    QString path;
+    TextEncoding::Encoding encoding;
+    bool bom;
+    LineEndings::Style endings;
+    Compression::Format compression;
+    int lastRevision;
 };
 
 //![codeeditordefinition]
@@ -52,22 +134,22 @@ private:
 class LineNumberArea : public QWidget
 {
 public:
-    LineNumberArea(CodeEditor *editor) : QWidget(editor), codeEditor(editor)
+    LineNumberArea(QWidget *parent, LineNumberHost *host) : QWidget(parent), host(host)
     {}
 
     QSize sizeHint() const override
     {
-        return QSize(codeEditor->lineNumberAreaWidth(), 0);
+        return QSize(host->lineNumberAreaWidth(), 0);
     }
 
 protected:
     void paintEvent(QPaintEvent *event) override
     {
-        codeEditor->lineNumberAreaPaintEvent(event);
+        host->lineNumberAreaPaintEvent(event);
     }
 
 private:
-    CodeEditor *codeEditor;
+    LineNumberHost *host;
 };
 
 //![extraarea]
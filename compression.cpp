@@ -0,0 +1,135 @@
+#include "compression.h"
+#include "trace.h"
+
+#include <QFile>
+#include <QProcess>
+
+#include <cstring>
+
+static const char *const programs[] = { nullptr, "gzip", "zstd", "xz" };
+static const int readChunkSize = 256 * 1024;
+
+/* Hands what is written to it to the standard input of a process. */
+class ProcessWriter : public QIODevice
+{
+public:
+    explicit ProcessWriter(QProcess *process) : process(process) {}
+
+protected:
+    qint64 readData(char *, qint64) override { return -1; }
+
+    qint64 writeData(const char *data, qint64 size) override
+    {
+        qint64 written = process->write(data, size);
+        while (process->bytesToWrite() > 0) {
+            if (!process->waitForBytesWritten(-1))
+                return -1;
+        }
+        return written;
+    }
+
+private:
+    QProcess *process;
+};
+
+Compression::Format Compression::detect(const char *data, int size)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b)
+        return Gzip;
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd)
+        return Zstd;
+    if (size >= 6 && std::memcmp(data, "\xfd" "7zXZ\0", 6) == 0)
+        return Xz;
+    return None;
+}
+
+Compression::Format Compression::detectFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return None;
+    QByteArray start = file.read(6);
+    return detect(start.constData(), start.size());
+}
+
+QString Compression::name(Format format)
+{
+    return format == None ? QString() : QString::fromLatin1(programs[format]);
+}
+
+bool Compression::startDecompressing(QProcess &process, Format format, const QString &fileName)
+{
+    if (format == None)
+        return false;
+    process.start(QString::fromLatin1(programs[format]), QStringList() << "-dc" << "--" << fileName);
+    return process.waitForStarted();
+}
+
+bool Compression::readFile(const QString &fileName, const std::function<void(const QByteArray &chunk)> &read,
+                           QString *error)
+{
+    Format format = detectFile(fileName);
+    if (format == None) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            *error = file.errorString();
+            return false;
+        }
+        for (;;) {
+            const QByteArray chunk = file.read(readChunkSize);
+            if (chunk.isEmpty()) {
+                if (file.error() == QFileDevice::NoError)
+                    return true;
+                *error = file.errorString();
+                return false;
+            }
+            read(chunk);
+        }
+    }
+
+    TraceSpan span("io", "decompress");
+    QProcess process;
+    if (!startDecompressing(process, format, fileName)) {
+        *error = process.errorString();
+        return false;
+    }
+    process.closeWriteChannel();
+    qint64 bytes = 0;
+    while (process.bytesAvailable() > 0 || process.waitForReadyRead(-1)) {
+        const QByteArray chunk = process.read(readChunkSize);
+        bytes += chunk.size();
+        read(chunk);
+    }
+    process.waitForFinished(-1);
+    span.arg("bytes", bytes);
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        *error = QString::fromLocal8Bit(process.readAllStandardError()).trimmed();
+        return false;
+    }
+    return true;
+}
+
+SaveFunction Compression::compressing(Format format, const SaveFunction &write)
+{
+    if (format == None)
+        return write;
+    return [format, write](QIODevice *device) {
+        TraceSpan span("io", "compress");
+        QFileDevice *file = qobject_cast<QFileDevice *>(device);
+        if (!file)
+            return false;
+        /* the compressor writes the file itself */
+        QProcess process;
+        process.setStandardOutputFile(file->fileName(), QIODevice::Truncate);
+        process.start(QString::fromLatin1(programs[format]), QStringList() << "-c");
+        if (!process.waitForStarted())
+            return false;
+        ProcessWriter pipe(&process);
+        pipe.open(QIODevice::WriteOnly);
+        bool ok = write(&pipe);
+        process.closeWriteChannel();
+        process.waitForFinished(-1);
+        return ok && process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    };
+}
@@ -0,0 +1,40 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <QByteArray>
+#include <QString>
+#include "asyncsaver.h"
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QProcess;
+QT_END_NAMESPACE
+
+/* Compressed files, told apart by their magic bytes. They are streamed
+   through the gzip, zstd and xz programs rather than linked libraries,
+   so a format only needs its program installed. */
+class Compression
+{
+public:
+    enum Format { None, Gzip, Zstd, Xz };
+
+    static Format detect(const char *data, int size);
+    static Format detectFile(const QString &fileName);
+    static QString name(Format format);
+
+    /* Starts decompressing a file into the standard output of process. */
+    static bool startDecompressing(QProcess &process, Format format, const QString &fileName);
+    /* Hands the file to read in chunks, decompressed on the way if it
+       is compressed, so that it is never whole in memory. Returns false
+       with error set if it could not be read to the end. Blocks; for
+       worker threads. */
+    static bool readFile(const QString &fileName, const std::function<void(const QByteArray &chunk)> &read,
+                         QString *error);
+
+    /* Compresses what write() writes, on the thread that saves it. The
+       device must be a file. */
+    static SaveFunction compressing(Format format, const SaveFunction &write);
+};
+
+#endif
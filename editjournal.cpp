@@ -0,0 +1,460 @@
+#include "editjournal.h"
+#include "trace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QMap>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUuid>
+#include <QtEndian>
+
+#include <algorithm>
+#include <climits>
+
+static const char journalMagic[] = "MPJR";
+static const char journalVersion = 1;
+static const char editRecord = 'E';
+// A full buffer is written at once instead of waiting for the timer.
+static const int flushSize = 64 * 1024;
+
+enum BaseKind
+{
+    FileBase = 'F',       // the file on disk, as identified by its size and time
+    CheckpointBase = 'C', // the .base file of the same generation
+    SavingBase = 'S'      // a file being saved, not identified yet
+};
+
+struct JournalHeader
+{
+    char kind;
+    qint64 size;
+    qint64 modified;
+    QString fileName;
+};
+
+/* All journal files are written by one thread, in the order of the
+   calls that queued the writes. */
+static QThreadPool *journalPool()
+{
+    static QThreadPool pool;
+    pool.setMaxThreadCount(1);
+    return &pool;
+}
+
+/* Where the records go; only used on the journal thread. */
+struct EditJournal::Worker
+{
+    QString log;
+};
+
+static void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+static bool readVarint(const QByteArray &data, int &pos, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size())
+            return false;
+        uchar byte = uchar(data.at(pos++));
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static void identify(const QString &fileName, qint64 &size, qint64 &modified)
+{
+    QFileInfo info(fileName);
+    size = info.exists() ? info.size() : -1;
+    modified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+static QByteArray headerBytes(const JournalHeader &header)
+{
+    QByteArray out(journalMagic, 4);
+    out.append(journalVersion);
+    out.append(header.kind);
+    char number[8];
+    qToLittleEndian(header.size, number);
+    out.append(number, 8);
+    qToLittleEndian(header.modified, number);
+    out.append(number, 8);
+    QByteArray name = header.fileName.toUtf8();
+    appendVarint(out, quint64(name.size()));
+    out.append(name);
+    return out;
+}
+
+/* Returns the offset of the first record, or -1. */
+static int readHeader(const QByteArray &data, JournalHeader &header)
+{
+    if (!data.startsWith(journalMagic) || data.size() < 22 || data.at(4) != journalVersion)
+        return -1;
+    header.kind = data.at(5);
+    header.size = qFromLittleEndian<qint64>(data.constData() + 6);
+    header.modified = qFromLittleEndian<qint64>(data.constData() + 14);
+    int pos = 22;
+    quint64 length;
+    if (!readVarint(data, pos, length) || pos + qint64(length) > data.size())
+        return -1;
+    header.fileName = QString::fromUtf8(data.constData() + pos, int(length));
+    return pos + int(length);
+}
+
+static QString filePrefix(const QString &key, int generation)
+{
+    return EditJournal::directory() + '/' + key + '-' + QString::number(generation);
+}
+
+/* The generations of a journal, by number. */
+static QMap<int, QString> generationLogs(const QString &key)
+{
+    QMap<int, QString> logs;
+    QDir dir(EditJournal::directory());
+    for (const QFileInfo &info : dir.entryInfoList(QStringList(key + "-*.log"), QDir::Files)) {
+        bool ok;
+        int generation = info.completeBaseName().mid(key.size() + 1).toInt(&ok);
+        if (ok)
+            logs.insert(generation, info.filePath());
+    }
+    return logs;
+}
+
+static void removeGenerations(const QString &key, int below)
+{
+    const QMap<int, QString> logs = generationLogs(key);
+    for (auto it = logs.constBegin(); it != logs.constEnd() && it.key() < below; ++it) {
+        QFile::remove(filePrefix(key, it.key()) + ".base");
+        QFile::remove(it.value());
+    }
+}
+
+EditJournal::EditJournal(const QString &fileName, QObject *parent) :
+    QObject(parent),
+    path(fileName),
+    key(QUuid::createUuid().toString(QUuid::Id128)),
+    lock(nullptr),
+    worker(new Worker),
+    flushTimer(new QTimer(this)),
+    checkpointBytes(4 << 20),
+    bytesSinceCheckpoint(0),
+    generation(-1),
+    active(false)
+{
+    flushTimer->setSingleShot(true);
+    connect(flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+}
+
+EditJournal::~EditJournal()
+{
+    flush();
+    delete lock;
+}
+
+QString EditJournal::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/journal";
+}
+
+void EditJournal::start(const SaveFunction &checkpoint)
+{
+    if (active || !QDir().mkpath(directory()))
+        return;
+    lock = new QLockFile(directory() + '/' + key + ".lock");
+    if (!lock->tryLock(0)) {
+        qWarning("Cannot lock the journal of %s", qPrintable(path));
+        return;
+    }
+    active = true;
+    newGeneration(checkpoint ? CheckpointBase : FileBase, checkpoint);
+}
+
+void EditJournal::record(qint64 position, qint64 removed, const QByteArray &inserted)
+{
+    if (!active)
+        return;
+    const int before = buffer.size();
+    buffer.append(editRecord);
+    appendVarint(buffer, quint64(position));
+    appendVarint(buffer, quint64(removed));
+    appendVarint(buffer, quint64(inserted.size()));
+    buffer.append(inserted);
+    bytesSinceCheckpoint += buffer.size() - before;
+
+    if (bytesSinceCheckpoint > checkpointBytes && snapshot) {
+        SaveFunction write = snapshot();
+        if (write) {
+            newGeneration(CheckpointBase, write);
+            return;
+        }
+        bytesSinceCheckpoint = 0; // asked again after as many records
+    }
+    if (buffer.size() > flushSize) {
+        flush();
+    } else if (!flushTimer->isActive()) {
+        flushTimer->start(1000);
+    }
+}
+
+void EditJournal::flush()
+{
+    flushTimer->stop();
+    if (buffer.isEmpty())
+        return;
+    QSharedPointer<Worker> worker = this->worker;
+    QByteArray records = buffer;
+    buffer.clear();
+    journalPool()->start([worker, records] {
+        if (worker->log.isEmpty())
+            return; // the journal could not be started
+        QFile log(worker->log);
+        if (log.open(QIODevice::WriteOnly | QIODevice::Append))
+            log.write(records);
+    });
+}
+
+/* The records so far go to the current generation, the next ones to a
+   new generation on the given base. */
+void EditJournal::newGeneration(char kind, const SaveFunction &write)
+{
+    flush();
+    bytesSinceCheckpoint = 0;
+    const int generation = ++this->generation;
+    const QString key = this->key;
+    const QString fileName = path;
+    QSharedPointer<Worker> worker = this->worker;
+    journalPool()->start([worker, key, generation, kind, fileName, write] {
+        TraceSpan span("io", "journalGeneration");
+        const QString prefix = filePrefix(key, generation);
+        JournalHeader header = { kind, -1, -1, fileName };
+        if (kind == FileBase)
+            identify(fileName, header.size, header.modified);
+        if (kind == CheckpointBase) {
+            QSaveFile base(prefix + ".base");
+            if (!base.open(QIODevice::WriteOnly) || !write(&base) || !base.commit())
+                return; // the records go on to the previous generation
+            span.arg("bytes", QFileInfo(base.fileName()).size());
+        }
+        QFile log(prefix + ".log");
+        if (!log.open(QIODevice::WriteOnly | QIODevice::Truncate) || log.write(headerBytes(header)) < 0)
+            return;
+        worker->log = log.fileName();
+        /* a file being saved replaces the older generations only once
+           it is there */
+        if (kind != SavingBase)
+            removeGenerations(key, generation);
+    });
+}
+
+void EditJournal::beginSave(const QString &fileName)
+{
+    if (!active)
+        return;
+    path = fileName;
+    newGeneration(SavingBase, SaveFunction());
+    savingGenerations.append(generation);
+}
+
+void EditJournal::endSave(bool saved)
+{
+    if (!active || savingGenerations.isEmpty())
+        return;
+    const int generation = savingGenerations.takeFirst();
+    if (!saved)
+        return;
+    flush();
+    const QString key = this->key;
+    const QString fileName = path;
+    journalPool()->start([key, generation, fileName] {
+        /* the saved file is now the base of its generation */
+        const QString logName = filePrefix(key, generation) + ".log";
+        QFile log(logName);
+        if (!log.open(QIODevice::ReadOnly))
+            return;
+        QByteArray data = log.readAll();
+        log.close();
+        JournalHeader header;
+        int recordsStart = readHeader(data, header);
+        if (recordsStart < 0)
+            return;
+        header.kind = FileBase;
+        header.fileName = fileName;
+        identify(fileName, header.size, header.modified);
+
+        QSaveFile patched(logName);
+        if (!patched.open(QIODevice::WriteOnly))
+            return;
+        patched.write(headerBytes(header));
+        patched.write(data.constData() + recordsStart, data.size() - recordsStart);
+        if (patched.commit())
+            removeGenerations(key, generation);
+    });
+}
+
+void EditJournal::discard()
+{
+    if (!active)
+        return;
+    active = false;
+    flushTimer->stop();
+    buffer.clear();
+    savingGenerations.clear();
+    const QString key = this->key;
+    QSharedPointer<Worker> worker = this->worker;
+    journalPool()->start([worker, key] {
+        worker->log.clear();
+        removeGenerations(key, INT_MAX);
+    });
+    lock->unlock();
+}
+
+EditJournal::Orphan EditJournal::suspend(const SaveFunction &checkpoint)
+{
+    Orphan orphan;
+    if (!active || !savingGenerations.isEmpty())
+        return orphan;
+    newGeneration(CheckpointBase, checkpoint);
+    journalPool()->waitForDone();
+    const QString prefix = filePrefix(key, generation);
+    if (worker->log != prefix + ".log")
+        return orphan;
+    active = false;
+    orphan.key = key;
+    orphan.fileName = path;
+    orphan.base = prefix + ".base";
+    orphan.logs.append(worker->log);
+    orphan.modified = QDateTime::currentDateTime();
+    return orphan;
+}
+
+QVector<EditJournal::Orphan> EditJournal::orphans()
+{
+    QVector<Orphan> found;
+    QDir dir(directory());
+    QStringList keys;
+    for (const QString &name : dir.entryList(QStringList("*.log"), QDir::Files)) {
+        QString key = name.left(name.lastIndexOf('-'));
+        if (!keys.contains(key))
+            keys.append(key);
+    }
+
+    for (const QString &key : keys) {
+        QLockFile lock(dir.filePath(key + ".lock"));
+        if (!lock.tryLock(0))
+            continue; // its document is still open
+
+        const QMap<int, QString> logs = generationLogs(key);
+        QMap<int, JournalHeader> headers;
+        for (auto it = logs.constBegin(); it != logs.constEnd(); ++it) {
+            QFile log(it.value());
+            JournalHeader header;
+            if (log.open(QIODevice::ReadOnly) && readHeader(log.read(64 * 1024), header) >= 0)
+                headers.insert(it.key(), header);
+        }
+
+        /* The replay starts from the newest generation whose base is
+           still there. If none is, a save has replaced the file before
+           its generation could be marked as saved. */
+        int first = -1;
+        for (auto it = headers.constEnd(); it != headers.constBegin();) {
+            --it;
+            const JournalHeader &header = it.value();
+            qint64 size, modified;
+            identify(header.fileName, size, modified);
+            if ((header.kind == CheckpointBase && QFile::exists(filePrefix(key, it.key()) + ".base"))
+                    || (header.kind == FileBase && header.size == size && header.modified == modified)) {
+                first = it.key();
+                break;
+            }
+        }
+        if (first < 0) {
+            for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+                if (it.value().kind == SavingBase) {
+                    first = it.key();
+                    break;
+                }
+            }
+        }
+
+        Orphan orphan;
+        orphan.key = key;
+        bool changed = false;
+        for (auto it = headers.constFind(first); first >= 0 && it != headers.constEnd(); ++it) {
+            const QString logName = logs.value(it.key());
+            orphan.logs.append(logName);
+            orphan.fileName = it.value().fileName;
+            QFileInfo info(logName);
+            orphan.modified = info.lastModified();
+            changed = changed || info.size() > headerBytes(it.value()).size();
+        }
+        if (first >= 0) {
+            const JournalHeader &header = headers.value(first);
+            if (header.kind == CheckpointBase) {
+                orphan.base = filePrefix(key, first) + ".base";
+                changed = true;
+            } else {
+                orphan.base = header.fileName;
+            }
+        }
+        lock.unlock();
+        if (changed)
+            found.append(orphan);
+        else
+            discard(orphan); // closed without edits, or nothing to recover
+    }
+
+    std::sort(found.begin(), found.end(), [](const Orphan &a, const Orphan &b) {
+        return a.modified > b.modified;
+    });
+    return found;
+}
+
+bool EditJournal::replay(const Orphan &orphan, const ReplayFunction &apply)
+{
+    TraceSpan span("io", "replayJournal");
+    qint64 records = 0;
+    for (const QString &logName : orphan.logs) {
+        QFile log(logName);
+        if (!log.open(QIODevice::ReadOnly))
+            return false;
+        const QByteArray data = log.readAll();
+        JournalHeader header;
+        int pos = readHeader(data, header);
+        if (pos < 0)
+            return false;
+        while (pos < data.size()) {
+            quint64 position, removed, length;
+            if (data.at(pos++) != editRecord || !readVarint(data, pos, position)
+                    || !readVarint(data, pos, removed) || !readVarint(data, pos, length)
+                    || pos + qint64(length) > data.size()) {
+                /* the last batch may have been cut short by the crash */
+                span.arg("records", records);
+                return logName == orphan.logs.last();
+            }
+            apply(qint64(position), qint64(removed), QByteArray(data.constData() + pos, int(length)));
+            pos += int(length);
+            ++records;
+        }
+    }
+    span.arg("records", records);
+    return true;
+}
+
+void EditJournal::discard(const Orphan &orphan)
+{
+    removeGenerations(orphan.key, INT_MAX);
+    QFile::remove(directory() + '/' + orphan.key + ".lock");
+}
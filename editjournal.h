@@ -0,0 +1,112 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+#include "asyncsaver.h"
+
+QT_BEGIN_NAMESPACE
+class QLockFile;
+class QTimer;
+QT_END_NAMESPACE
+
+/* An append-only log of the edits of a document, from which its unsaved
+   changes can be recovered after a crash.
+
+   Records are appended to a buffer in memory and written in batches on
+   a worker thread, at the latest a second later. A log starts with
+   "MPJR", a version byte and its base: the file as it was on disk, a
+   checkpoint of the whole text kept beside the log, or a file that was
+   being saved. The base kind is followed by the size and modification
+   time of the file, as 64-bit little-endian numbers, and by the
+   varint-prefixed UTF-8 name of the file. Each record is an 'E' byte
+   and varints: the position, the removed length, and the length of the
+   inserted UTF-8 text, which follows. Positions are in the units of the
+   document: characters of a CodeEditor, bytes of a LargeFileView.
+
+   Checkpoints and saves start a new generation of the log, so that
+   older generations can be deleted once their replacement is safely on
+   disk. The journals live in the application data directory and are
+   locked while their document is open; EditJournal::orphans() finds
+   those left behind by a crash. */
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    /* The unsaved changes of a document that was not closed. */
+    struct Orphan
+    {
+        QString key;
+        QString fileName;
+        QString base;      // the text to open before replaying the logs
+        QStringList logs;  // in order
+        QDateTime modified;
+    };
+
+    typedef std::function<void(qint64 position, qint64 removed, const QByteArray &inserted)> ReplayFunction;
+
+    explicit EditJournal(const QString &fileName, QObject *parent = nullptr);
+    ~EditJournal();
+
+    /* Starts logging the edits of a document whose text is the file on
+       disk, or the given checkpoint when it is not. */
+    void start(const SaveFunction &checkpoint = SaveFunction());
+    bool isActive() const { return active; }
+    /* Takes the snapshots for the checkpoints, which are written after
+       every checkpointBytes of records. A null snapshot skips one: the
+       records go on in the same generation. */
+    void setSnapshotFunction(const std::function<SaveFunction()> &snapshot) { this->snapshot = snapshot; }
+    void setCheckpointBytes(qint64 bytes) { checkpointBytes = bytes; }
+
+    /* Called when a snapshot of the document is being saved to fileName,
+       and when that save has finished, in the same order. */
+    void beginSave(const QString &fileName);
+    void endSave(bool saved);
+
+    /* Deletes the journal, once the document is closed or replaced. */
+    void discard();
+    /* Stops logging after a checkpoint of the document, which is on disk
+       when this returns, so that the document can be dropped and read
+       back later from the returned orphan. The journal stays locked until
+       this object is deleted. Returns an orphan without a key if the
+       checkpoint could not be written; the journal then goes on. */
+    Orphan suspend(const SaveFunction &checkpoint);
+
+    static QString directory();
+    /* Newest first. */
+    static QVector<Orphan> orphans();
+    static bool replay(const Orphan &orphan, const ReplayFunction &apply);
+    static void discard(const Orphan &orphan);
+
+public slots:
+    void record(qint64 position, qint64 removed, const QByteArray &inserted);
+    void flush();
+
+private:
+    struct Worker;
+
+    void newGeneration(char kind, const SaveFunction &write);
+
+    QString path;
+    QString key;
+    QLockFile *lock;
+    QSharedPointer<Worker> worker;
+    QByteArray buffer;
+    QTimer *flushTimer;
+    std::function<SaveFunction()> snapshot;
+    qint64 checkpointBytes;
+    qint64 bytesSinceCheckpoint;
+    int generation;
+    QVector<int> savingGenerations;
+    bool active;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "editrecorder.h"
+#include "codeeditor.h"
+
+#include <QCryptographicHash>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTimer>
+
+static const char traceMagic[] = "MPTR";
+static const char traceVersion = 1;
+
+static quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+static qint64 unzigzag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+EditRecorder::EditRecorder(const QString &fileName, QObject *parent) :
+    QObject(parent),
+    editor(nullptr),
+    file(fileName),
+    lastUsecs(0),
+    flushTimer(new QTimer(this))
+{
+    /* a crash loses at most a second of the session */
+    connect(flushTimer, &QTimer::timeout, this, &EditRecorder::flush);
+}
+
+void EditRecorder::start(CodeEditor *editor)
+{
+    if (this->editor)
+        disconnect(this->editor, nullptr, this, nullptr);
+    this->editor = editor;
+    buffer.clear();
+    file.close();
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Cannot record the edit trace to %s", qPrintable(file.fileName()));
+        return;
+    }
+
+    QTextDocument *document = editor->document();
+    buffer.append(traceMagic, 4);
+    buffer.append(traceVersion);
+    writeVarint(quint64(qMax(0, document->characterCount() - 1)));
+    buffer.append(EditTraceReader::md5Of(document));
+    clock.start();
+    lastUsecs = 0;
+
+    /* not the contentsChange() of the document, which also reports each
+       pass of the highlighter */
+    connect(editor, &CodeEditor::edited, this, &EditRecorder::contentsChange);
+    connect(editor, &QPlainTextEdit::cursorPositionChanged, this, &EditRecorder::cursorMoved);
+    connect(editor, &QPlainTextEdit::selectionChanged, this, &EditRecorder::cursorMoved);
+    flushTimer->start(1000);
+}
+
+EditRecorder::~EditRecorder()
+{
+    flush();
+}
+
+void EditRecorder::flush()
+{
+    if (!file.isOpen() || buffer.isEmpty())
+        return;
+    file.write(buffer);
+    file.flush();
+    buffer.clear();
+}
+
+void EditRecorder::beginRecord(char type)
+{
+    qint64 now = clock.nsecsElapsed() / 1000;
+    buffer.append(type);
+    writeVarint(quint64(now - lastUsecs));
+    lastUsecs = now;
+}
+
+void EditRecorder::writeVarint(quint64 value)
+{
+    while (value >= 0x80) {
+        buffer.append(char(value | 0x80));
+        value >>= 7;
+    }
+    buffer.append(char(value));
+}
+
+void EditRecorder::contentsChange(qint64 position, qint64 removed, const QByteArray &inserted)
+{
+    if (!file.isOpen())
+        return;
+
+    beginRecord(EditTraceRecord::Edit);
+    writeVarint(quint64(position));
+    writeVarint(quint64(removed));
+    writeVarint(quint64(inserted.size()));
+    buffer.append(inserted);
+
+    if (buffer.size() > 64 * 1024)
+        flush();
+}
+
+void EditRecorder::cursorMoved()
+{
+    if (!isRecording())
+        return;
+    QTextCursor cursor = editor->textCursor();
+    beginRecord(EditTraceRecord::Cursor);
+    writeVarint(quint64(cursor.position()));
+    writeVarint(zigzag(cursor.anchor() - cursor.position()));
+}
+
+EditTraceReader::EditTraceReader(const QString &fileName) :
+    pos(0),
+    valid(false),
+    length(0)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    data = file.readAll();
+
+    if (!data.startsWith(traceMagic) || data.size() < 5 || data.at(4) != traceVersion)
+        return;
+    pos = 5;
+    quint64 value;
+    if (!readVarint(value) || pos + 16 > data.size())
+        return;
+    length = int(value);
+    md5 = data.mid(pos, 16);
+    pos += 16;
+    valid = true;
+}
+
+bool EditTraceReader::readVarint(quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size())
+            return false;
+        uchar byte = uchar(data.at(pos++));
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool EditTraceReader::next(EditTraceRecord &record)
+{
+    if (!valid || pos >= data.size())
+        return false;
+
+    char type = data.at(pos++);
+    quint64 usecs, position, value;
+    if (!readVarint(usecs) || !readVarint(position) || !readVarint(value))
+        return valid = false;
+
+    record.usecs = qint64(usecs);
+    record.position = int(position);
+    record.text.clear();
+    if (type == EditTraceRecord::Edit) {
+        quint64 size;
+        if (!readVarint(size) || pos + qint64(size) > data.size())
+            return valid = false;
+        record.type = EditTraceRecord::Edit;
+        record.removed = int(value);
+        record.anchor = record.position;
+        record.text = QString::fromUtf8(data.constData() + pos, int(size));
+        pos += int(size);
+    } else if (type == EditTraceRecord::Cursor) {
+        record.type = EditTraceRecord::Cursor;
+        record.removed = 0;
+        record.anchor = record.position + int(unzigzag(value));
+    } else {
+        return valid = false;
+    }
+    return true;
+}
+
+QByteArray EditTraceReader::md5Of(const QTextDocument *document)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        if (block != document->begin())
+            hash.addData(QByteArrayLiteral("\n"));
+        hash.addData(block.text().toUtf8());
+    }
+    return hash.result();
+}
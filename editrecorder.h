@@ -0,0 +1,98 @@
+#ifndef EDITRECORDER_H
+#define EDITRECORDER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+class QTimer;
+QT_END_NAMESPACE
+
+class CodeEditor;
+
+/* One operation of a recorded edit session. */
+struct EditTraceRecord
+{
+    enum Type { Edit = 'E', Cursor = 'C' };
+
+    Type type;
+    qint64 usecs;  // time since the previous record
+    int position;
+    int removed;   // Edit: the number of removed characters
+    int anchor;    // Cursor: the other end of the selection
+    QString text;  // Edit: the inserted text
+};
+
+/* Writes the contents changes and cursor moves of an editor into a
+   compact binary trace, which EditTraceReader reads back.
+
+   The trace starts with "MPTR", a version byte, the length and the
+   MD5 sum of the starting text. Each record is a type byte followed by
+   varints: the microseconds since the previous record, then the
+   position, and either the removed length and the UTF-8 inserted text
+   (Edit) or the zigzag-encoded anchor offset (Cursor).
+
+   A trace is of one document: it starts over each time start() is
+   called, as when another editor is shown or a file was read again. */
+class EditRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditRecorder(const QString &fileName, QObject *parent = nullptr);
+    ~EditRecorder();
+
+    /* Records the edits of editor from its current text on. */
+    void start(CodeEditor *editor);
+    CodeEditor *recordedEditor() const { return editor; }
+    bool isRecording() const { return file.isOpen() && editor; }
+
+public slots:
+    void flush();
+
+private slots:
+    void contentsChange(qint64 position, qint64 removed, const QByteArray &inserted);
+    void cursorMoved();
+
+private:
+    void beginRecord(char type);
+    void writeVarint(quint64 value);
+
+    QPointer<CodeEditor> editor;
+    QFile file;
+    QByteArray buffer;
+    QElapsedTimer clock;
+    qint64 lastUsecs;
+    QTimer *flushTimer;
+};
+
+class EditTraceReader
+{
+public:
+    EditTraceReader(const QString &fileName);
+
+    bool isValid() const { return valid; }
+    int startLength() const { return length; }
+    QByteArray startMd5() const { return md5; }
+
+    /* Returns false at the end of the trace or on a malformed record. */
+    bool next(EditTraceRecord &record);
+
+    static QByteArray md5Of(const QTextDocument *document);
+
+private:
+    bool readVarint(quint64 &value);
+
+    QByteArray data;
+    int pos;
+    bool valid;
+    int length;
+    QByteArray md5;
+};
+
+#endif
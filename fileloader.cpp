@@ -0,0 +1,163 @@
+#include "fileloader.h"
+#include "textencoding.h"
+#include "trace.h"
+
+#include <QFile>
+#include <QProcess>
+#include <QThreadPool>
+
+static const int firstChunkSize = 64 * 1024;
+static const int chunkSize = 256 * 1024;
+// Chunks read but not yet appended by the receiver.
+static const int maxChunksInFlight = 4;
+
+FileLoader::FileLoader(QObject *parent) : QObject(parent),
+    freeSlots(maxChunksInFlight),
+    idle(1),
+    encoding(TextEncoding::Utf8),
+    bom(false),
+    format(Compression::None),
+    readBytes(0)
+{
+}
+
+FileLoader::~FileLoader()
+{
+    cancel();
+    idle.acquire();
+}
+
+void FileLoader::load(const QString &fileName)
+{
+    cancel();
+    idle.acquire(); // the previous read has stopped
+    path = fileName;
+    canceledFlag.storeRelaxed(0);
+    freeSlots.acquire(freeSlots.available());
+    freeSlots.release(maxChunksInFlight);
+    QThreadPool::globalInstance()->start([this] {
+        run();
+        idle.release();
+    });
+}
+
+void FileLoader::cancel()
+{
+    canceledFlag.storeRelaxed(1);
+    freeSlots.release(maxChunksInFlight); // wakes the reader up
+}
+
+void FileLoader::chunkDone()
+{
+    freeSlots.release();
+}
+
+void FileLoader::run()
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit failed(file.errorString());
+        return;
+    }
+    /* compressed files are streamed through their decompressor, whose
+       output size is only known at the end */
+    format = Compression::detectFile(path);
+    QProcess process;
+    if (format != Compression::None) {
+        file.close();
+        if (!Compression::startDecompressing(process, format, path)) {
+            emit failed(process.errorString());
+            return;
+        }
+        process.closeWriteChannel();
+    }
+    const bool streaming = format != Compression::None;
+
+    const qint64 total = streaming ? 0 : file.size();
+    qint64 done = 0;
+    qint64 decoded = 0; // offset of the first byte in pending
+    QByteArray pending;
+    int size = firstChunkSize;
+    bool detected = false;
+    bool reportInvalid = true;
+    bool heldCr = false;
+    encoding = TextEncoding::Utf8;
+    bom = false;
+    endings = LineEndings();
+    readBytes = 0;
+    for (;;) {
+        freeSlots.acquire();
+        if (canceledFlag.loadRelaxed()) {
+            emit canceled();
+            return;
+        }
+
+        TraceSpan span("io", "readChunk");
+        QByteArray bytes;
+        if (streaming) {
+            while (bytes.size() < size && (process.bytesAvailable() > 0 || process.waitForReadyRead(-1)))
+                bytes += process.read(size - bytes.size());
+        } else {
+            bytes = file.read(size);
+            if (bytes.isEmpty() && file.error() != QFileDevice::NoError) {
+                emit failed(file.errorString());
+                return;
+            }
+        }
+        done += bytes.size();
+        span.arg("bytes", bytes.size());
+        const bool atEnd = bytes.size() < size || (!streaming && file.atEnd());
+
+        pending += bytes;
+        if (!detected) {
+            /* the first chunk decides, so the first screen is not held
+               up by a check of the whole file */
+            TextEncoding::Detection detection = TextEncoding::detect(pending.constData(), pending.size());
+            encoding = detection.encoding;
+            bom = detection.bomLength > 0;
+            pending.remove(0, detection.bomLength);
+            decoded = detection.bomLength;
+            detected = true;
+            emit encodingDetected(TextEncoding::name(encoding));
+        }
+
+        int length = pending.size();
+        if (!atEnd)
+            length = TextEncoding::completeLength(pending.constData(), pending.size(), encoding);
+        qint64 invalid = -1;
+        QString text = TextEncoding::decode(pending.constData(), length, encoding, &invalid);
+        if (invalid >= 0 && reportInvalid) {
+            emit invalidSequence(decoded + invalid);
+            reportInvalid = false;
+        }
+        if (encoding == TextEncoding::Utf8 || encoding == TextEncoding::Latin1)
+            endings.scan(pending.constData(), length);
+        else
+            endings.scan(text.constData(), text.size());
+        pending.remove(0, length);
+        decoded += length;
+
+        /* a CR is kept until it is known whether it starts a CRLF, which
+           the document would otherwise split into two blocks */
+        if (heldCr)
+            text.prepend(QLatin1Char('\r'));
+        heldCr = !atEnd && text.endsWith(QLatin1Char('\r'));
+        if (heldCr)
+            text.chop(1);
+        emit chunkRead(text, done, total);
+
+        if (atEnd)
+            break;
+        size = chunkSize;
+    }
+    if (streaming) {
+        process.waitForFinished(-1);
+        if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+            emit failed(Compression::name(format) + ": " + QString::fromLocal8Bit(process.readAllStandardError()).trimmed());
+            return;
+        }
+    }
+    endings.finish();
+    readBytes = done;
+    emit loaded();
+}
@@ -0,0 +1,66 @@
+#ifndef FILELOADER_H
+#define FILELOADER_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QSemaphore>
+#include "compression.h"
+#include "lineendings.h"
+#include "textencoding.h"
+
+/* Reads a file on a thread of the global pool, which all documents
+   share, and hands it over in decoded chunks, so the window stays
+   responsive while the document grows. Compressed files are
+   decompressed on the way, without a copy on disk. The first
+   chunk is small to get the first screen out quickly. At most a few
+   chunks are in flight: the receiver calls chunkDone() after each. */
+class FileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileLoader(QObject *parent = nullptr);
+    ~FileLoader();
+
+    void load(const QString &fileName);
+    void cancel();
+    void chunkDone();
+    QString fileName() const { return path; }
+
+    /* What the file was made of; valid once loaded() is sent. */
+    TextEncoding::Encoding textEncoding() const { return encoding; }
+    bool hasBom() const { return bom; }
+    Compression::Format compression() const { return format; }
+    const LineEndings &lineEndings() const { return endings; }
+    /* More than the size at the start if the file grew meanwhile;
+       the decompressed size of a compressed file. */
+    qint64 bytesRead() const { return readBytes; }
+
+signals:
+    void encodingDetected(const QString &encoding);
+    /* Sent once, for the first byte that is not valid UTF-8 in a file
+       that started as valid UTF-8. Such bytes are kept in the text as
+       escapes (see TextEncoding::decode()), so they are saved back as
+       they were. */
+    void invalidSequence(qint64 offset);
+    /* totalBytes is 0 while a compressed file is read. */
+    void chunkRead(const QString &text, qint64 bytesRead, qint64 totalBytes);
+    void loaded();
+    void canceled();
+    void failed(const QString &error);
+
+private:
+    void run();
+
+    QString path;
+    QAtomicInt canceledFlag;
+    QSemaphore freeSlots;
+    QSemaphore idle; // available while no read is going on
+    TextEncoding::Encoding encoding;
+    bool bom;
+    Compression::Format format;
+    LineEndings endings;
+    qint64 readBytes;
+};
+
+#endif
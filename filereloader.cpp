@@ -0,0 +1,244 @@
+#include "filereloader.h"
+#include "codeeditor.h"
+#include "compression.h"
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QPointer>
+#include <QTextBlock>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <climits>
+
+// Writers usually take a few calls to write a file.
+static const int checkDelay = 100;
+
+/* One watcher for all documents: each costs an inotify instance, of
+   which a user only gets a few. Files open in several documents are
+   counted. */
+static QFileSystemWatcher *sharedWatcher()
+{
+    static QFileSystemWatcher *watcher = new QFileSystemWatcher(qApp);
+    return watcher;
+}
+
+static QHash<QString, int> watchCounts;
+
+FileReloader::FileReloader(CodeEditor *editor, QObject *parent) : QObject(parent),
+    editor(editor),
+    watcher(sharedWatcher()),
+    checkTimer(new QTimer(this)),
+    size(-1),
+    modified(-1),
+    reloadRevision(-1)
+{
+    checkTimer->setSingleShot(true);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &FileReloader::fileChanged);
+    connect(checkTimer, &QTimer::timeout, this, &FileReloader::check);
+}
+
+FileReloader::~FileReloader()
+{
+    unwatch();
+}
+
+void FileReloader::watch()
+{
+    unwatch();
+    path = editor->fileName();
+    QFileInfo info(path);
+    if (path.isEmpty() || !info.exists()) {
+        path.clear();
+        return;
+    }
+    size = info.size();
+    modified = info.lastModified().toMSecsSinceEpoch();
+    if (watchCounts[path]++ == 0)
+        watcher->addPath(path);
+}
+
+void FileReloader::unwatch()
+{
+    if (!path.isEmpty() && watchCounts.contains(path) && --watchCounts[path] == 0) {
+        watchCounts.remove(path);
+        watcher->removePath(path);
+    }
+    checkTimer->stop();
+    path.clear();
+    reloadRevision = -1;
+}
+
+void FileReloader::fileChanged(const QString &fileName)
+{
+    if (fileName == path)
+        checkTimer->start(checkDelay);
+}
+
+void FileReloader::check()
+{
+    if (path.isEmpty())
+        return;
+    QFileInfo info(path);
+    if (!info.exists())
+        return; // deleted, or not renamed into place yet
+    /* a file replaced by a rename is a new file to the watcher */
+    if (!watcher->files().contains(path))
+        watcher->addPath(path);
+    if (info.size() != size || info.lastModified().toMSecsSinceEpoch() != modified)
+        emit changed(path);
+}
+
+void FileReloader::reload()
+{
+    if (path.isEmpty() || reloadRevision >= 0)
+        return;
+    TraceSpan span("io", "hashLines");
+    QTextDocument *document = editor->document();
+    QVector<quint64> oldLines;
+    oldLines.reserve(document->blockCount());
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        const QString text = block.text();
+        oldLines.append(LineDiff::hash(text.constData(), text.size()));
+    }
+    span.arg("lines", oldLines.size());
+
+    reloadRevision = editor->revision();
+    const QString fileName = path;
+    const TextEncoding::Encoding encoding = editor->textEncoding();
+    QPointer<FileReloader> self(this);
+    QThreadPool::globalInstance()->start([self, fileName, encoding, oldLines] {
+        Result result = compare(fileName, encoding, oldLines);
+        QMetaObject::invokeMethod(self, [self, fileName, result] {
+            if (self && self->path == fileName)
+                self->apply(result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+FileReloader::Result FileReloader::compare(const QString &fileName, TextEncoding::Encoding encoding, const QVector<quint64> &oldLines)
+{
+    TraceSpan span("io", "diffReload");
+    Result result;
+    QFileInfo info(fileName);
+    result.modified = info.lastModified().toMSecsSinceEpoch();
+    result.size = info.size();
+    result.text.reserve(int(qMin<qint64>(result.size, INT_MAX)));
+
+    /* lines end where the document would break blocks: at LF, CR LF or
+       CR; they are hashed as the text comes in, but a CR at its end has
+       to wait for the next chunk */
+    QVector<quint64> newLines;
+    int start = 0; // of the line being read
+    int i = 0; // the next character to look at
+    auto splitLines = [&](bool atEnd) {
+        const QChar *data = result.text.constData();
+        const int length = result.text.size();
+        for (; i <= length; ++i) {
+            if (i == length) {
+                if (!atEnd)
+                    break;
+            } else if (data[i] != QLatin1Char('\n') && data[i] != QLatin1Char('\r')) {
+                continue;
+            } else if (i + 1 == length && data[i] == QLatin1Char('\r') && !atEnd) {
+                break;
+            }
+            result.lineStarts.append(start);
+            result.lineEnds.append(i);
+            newLines.append(LineDiff::hash(data + start, i - start));
+            if (i + 1 < length && data[i] == QLatin1Char('\r') && data[i + 1] == QLatin1Char('\n'))
+                ++i;
+            start = i + 1;
+        }
+    };
+
+    /* decoded chunk by chunk, as FileLoader does, so that the bytes of
+       the file are never whole in memory next to its text */
+    QByteArray pending; // the bytes of a character cut by the chunk
+    bool first = true;
+    const bool read = Compression::readFile(fileName, [&](const QByteArray &chunk) {
+        pending += chunk;
+        int skip = 0;
+        if (first) {
+            TextEncoding::Detection detection = TextEncoding::detect(pending.constData(), qMin(pending.size(), 64 * 1024));
+            skip = detection.encoding == encoding ? detection.bomLength : 0;
+            first = false;
+        }
+        const int length = TextEncoding::completeLength(pending.constData() + skip, pending.size() - skip, encoding);
+        result.text += TextEncoding::decode(pending.constData() + skip, length, encoding);
+        pending.remove(0, skip + length);
+        splitLines(false);
+    }, &result.error);
+    if (!read)
+        return result;
+    result.text += TextEncoding::decode(pending.constData(), pending.size(), encoding);
+    splitLines(true);
+
+    result.hunks = LineDiff::diff(oldLines, newLines);
+    span.arg("lines", newLines.size());
+    span.arg("hunks", result.hunks.size());
+    return result;
+}
+
+void FileReloader::apply(const Result &result)
+{
+    if (editor->revision() != reloadRevision) {
+        /* edited meanwhile: the hashes are stale */
+        reloadRevision = -1;
+        reload();
+        return;
+    }
+    reloadRevision = -1;
+    if (!result.error.isEmpty()) {
+        emit failed(result.error);
+        return;
+    }
+
+    TraceSpan span("io", "applyReload");
+    span.arg("hunks", result.hunks.size());
+    QTextDocument *document = editor->document();
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    /* from the last hunk up, so that the line numbers of the others hold */
+    for (int i = result.hunks.size() - 1; i >= 0; --i) {
+        const LineDiff::Hunk &hunk = result.hunks.at(i);
+        const int blocks = document->blockCount();
+        /* the line breaks in between are kept as they are in the file,
+           the document takes them all */
+        QString text;
+        if (hunk.newCount > 0) {
+            const int from = result.lineStarts.at(hunk.newStart);
+            text = result.text.mid(from, result.lineEnds.at(hunk.newStart + hunk.newCount - 1) - from);
+        }
+        int start, end;
+        if (hunk.oldStart + hunk.oldCount < blocks) {
+            /* whole lines with their line breaks */
+            start = document->findBlockByNumber(hunk.oldStart).position();
+            end = document->findBlockByNumber(hunk.oldStart + hunk.oldCount).position();
+            if (hunk.newCount > 0)
+                text += QLatin1Char('\n');
+        } else {
+            /* up to the end, which has no line break */
+            end = document->characterCount() - 1;
+            start = hunk.oldStart < blocks ? document->findBlockByNumber(hunk.oldStart).position() : end;
+            if (hunk.newCount == 0 && hunk.oldStart > 0) {
+                QTextBlock previous = document->findBlockByNumber(hunk.oldStart - 1);
+                start = previous.position() + previous.length() - 1;
+            } else if (hunk.oldStart >= blocks) {
+                text.prepend(QLatin1Char('\n'));
+            }
+        }
+        cursor.setPosition(start);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+        cursor.insertText(text);
+    }
+    cursor.endEditBlock();
+    document->setModified(false);
+
+    size = result.size;
+    modified = result.modified;
+    emit reloaded(result.hunks.size());
+}
@@ -0,0 +1,71 @@
+#ifndef FILERELOADER_H
+#define FILERELOADER_H
+
+#include <QObject>
+#include <QVector>
+#include "linediff.h"
+#include "textencoding.h"
+
+QT_BEGIN_NAMESPACE
+class QFileSystemWatcher;
+class QTimer;
+QT_END_NAMESPACE
+
+class CodeEditor;
+
+/* Brings a CodeEditor up to date when its file changes on disk, as when
+   a build rewrites a generated file or git checks out another version.
+   The new text is read and compared with the document by the hashes of
+   their lines on a worker thread. Only the hunks that differ are then
+   replaced, in one undoable edit, so the highlighting and layout of the
+   rest, the cursor and the scroll position are kept. */
+class FileReloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileReloader(CodeEditor *editor, QObject *parent = nullptr);
+    ~FileReloader();
+
+    /* Watches the file of the editor, taking its current version on
+       disk as the one in the editor. */
+    void watch();
+    void unwatch();
+    void reload();
+    qint64 fileSize() const { return size; }
+
+signals:
+    /* The file is no longer the version in the editor. */
+    void changed(const QString &fileName);
+    void reloaded(int hunks);
+    void failed(const QString &error);
+
+private slots:
+    void fileChanged(const QString &fileName);
+    void check();
+
+private:
+    struct Result
+    {
+        QString error;
+        qint64 size;
+        qint64 modified;
+        QString text;
+        QVector<int> lineStarts;
+        QVector<int> lineEnds; // before the line break
+        QVector<LineDiff::Hunk> hunks;
+    };
+
+    static Result compare(const QString &fileName, TextEncoding::Encoding encoding, const QVector<quint64> &oldLines);
+    void apply(const Result &result);
+
+    CodeEditor *editor;
+    QFileSystemWatcher *watcher;
+    QTimer *checkTimer;
+    QString path;
+    qint64 size;
+    qint64 modified;
+    int reloadRevision; // of the document when the reload started, or -1
+};
+
+#endif
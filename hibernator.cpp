@@ -0,0 +1,65 @@
+#include "hibernator.h"
+#include "trace.h"
+
+#include <QTimer>
+
+// How often idle documents are looked at; a timeout is met this late at most.
+static const int checkInterval = 15 * 1000;
+
+Hibernator::Hibernator(QObject *parent) : QObject(parent),
+    timer(new QTimer(this)),
+    timeoutSeconds(0),
+    current(nullptr)
+{
+    clock.start();
+    connect(timer, &QTimer::timeout, this, &Hibernator::check);
+}
+
+void Hibernator::setTimeout(int seconds)
+{
+    timeoutSeconds = qMax(0, seconds);
+    if (timeoutSeconds > 0)
+        timer->start(qMin(checkInterval, timeoutSeconds * 1000));
+    else
+        timer->stop();
+}
+
+void Hibernator::setCurrent(QWidget *document)
+{
+    if (document == current)
+        return;
+    if (current)
+        leftAt.insert(current, clock.elapsed());
+    current = document;
+    if (!document)
+        return;
+    leftAt.remove(document);
+    if (hibernating.remove(document)) {
+        TraceSpan span("memory", "wake");
+        emit wake(document);
+    }
+}
+
+void Hibernator::remove(QWidget *document)
+{
+    if (current == document)
+        current = nullptr;
+    leftAt.remove(document);
+    hibernating.remove(document);
+}
+
+void Hibernator::check()
+{
+    const qint64 now = clock.elapsed();
+    QList<QWidget *> idle;
+    for (auto it = leftAt.constBegin(); it != leftAt.constEnd(); ++it) {
+        if (!hibernating.contains(it.key()) && now - it.value() >= qint64(timeoutSeconds) * 1000)
+            idle.append(it.key());
+    }
+    /* the handlers may remove documents */
+    for (QWidget *document : idle) {
+        hibernating.insert(document);
+        TraceSpan span("memory", "hibernate");
+        emit hibernate(document);
+    }
+}
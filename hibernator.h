@@ -0,0 +1,51 @@
+#ifndef HIBERNATOR_H
+#define HIBERNATOR_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+class QWidget;
+QT_END_NAMESPACE
+
+/* Tells when documents in the background have gone unused long enough
+   that their memory is better given back, and when they are needed
+   again. The current document is never idle; the others are idle from
+   the time they were left. What a document drops when it hibernates is
+   up to whoever handles hibernate(). */
+class Hibernator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Hibernator(QObject *parent = nullptr);
+
+    /* 0 turns hibernation off. */
+    void setTimeout(int seconds);
+    int timeout() const { return timeoutSeconds; }
+    /* The document being worked in, or nullptr while the window is in
+       the background. Wakes it if it was hibernating. */
+    void setCurrent(QWidget *document);
+    void remove(QWidget *document);
+    bool isHibernating(QWidget *document) const { return hibernating.contains(document); }
+
+signals:
+    void hibernate(QWidget *document);
+    void wake(QWidget *document);
+
+private slots:
+    void check();
+
+private:
+    QTimer *timer;
+    QElapsedTimer clock;
+    int timeoutSeconds;
+    QWidget *current;
+    QHash<QWidget *, qint64> leftAt; // clock time each idle document was left
+    QSet<QWidget *> hibernating;
+};
+
+#endif
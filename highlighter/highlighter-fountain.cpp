@@ -276,7 +276,7 @@ void Highlighter::highlightFountainBlock (const QString &text)
 
     /* main formatting */
     int bn = currentBlock().blockNumber();
-    if (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber())
+    if (isInLimits (bn))
     {
         data->setHighlighted();
         QRegularExpressionMatch match;
@@ -65,7 +65,7 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
     }
 
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isInLimits (bn));
     //bool hugeText (text.length() > 50000);
     int firstBraIndex = braIndex; // to check progress in the following loop
     while (braIndex >= 0)
@@ -419,7 +419,7 @@ void Highlighter::htmlCSSHighlighter (const QString &text, const int start)
     }
     TextBlockData *curData = static_cast<TextBlockData *>(currentBlock().userData());
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isInLimits (bn));
     while (cssIndex >= 0)
     {
         /* single-line style bracket (<style ...>) */
@@ -563,7 +563,7 @@ void Highlighter::htmlJavascript (const QString &text)
     int matched = 0;
     TextBlockData *curData = static_cast<TextBlockData *>(currentBlock().userData());
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isInLimits (bn));
     while (javaIndex >= 0)
     {
         if (!wasJavascript || javaIndex > 0)
@@ -345,7 +345,7 @@ void Highlighter::highlightJsonBlock (const QString &text)
     }
 
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isInLimits (bn));
     if (mainFormatting)
         setFormat (0, txtL, mainFormat);
 
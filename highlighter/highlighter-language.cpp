@@ -0,0 +1,62 @@
+#include "highlighter.h"
+
+/* Guesses the highlighting language from a file name. An empty
+   string is returned if the name doesn't match any language. */
+QString Highlighter::languageForFile (const QString &fileName)
+{
+    const QString baseName = fileName.section ('/', -1).toLower();
+
+    if (baseName == "cmakelists.txt" || baseName.endsWith (".cmake"))
+        return "cmake";
+    if (baseName == "makefile" || baseName == "gnumakefile")
+        return "makefile";
+    if (baseName == "changelog")
+        return "changelog";
+    if (baseName == "gtkrc" || baseName.startsWith (".gtkrc"))
+        return "gtkrc";
+
+    static const QHash<QString, QString> suffixes = {
+        {"c", "c"},
+        {"h", "cpp"}, {"hh", "cpp"}, {"hpp", "cpp"}, {"hxx", "cpp"},
+        {"cc", "cpp"}, {"cpp", "cpp"}, {"cxx", "cpp"}, {"c++", "cpp"},
+        {"sh", "sh"}, {"bash", "sh"}, {"zsh", "sh"}, {"ksh", "sh"},
+        {"pl", "perl"}, {"pm", "perl"}, {"perl", "perl"},
+        {"py", "python"}, {"pyw", "python"},
+        {"rb", "ruby"},
+        {"lua", "lua"},
+        {"js", "javascript"}, {"mjs", "javascript"}, {"cjs", "javascript"},
+        {"qml", "qml"},
+        {"java", "java"},
+        {"json", "json"},
+        {"xml", "xml"}, {"svg", "xml"}, {"xsl", "xml"}, {"ui", "xml"}, {"qrc", "xml"},
+        {"html", "html"}, {"htm", "html"}, {"xhtml", "html"},
+        {"css", "css"},
+        {"scss", "scss"},
+        {"md", "markdown"}, {"markdown", "markdown"},
+        {"rst", "reST"},
+        {"yaml", "yaml"}, {"yml", "yaml"},
+        {"tcl", "tcl"}, {"tk", "tcl"},
+        {"rs", "rust"},
+        {"go", "go"},
+        {"dart", "dart"},
+        {"php", "php"},
+        {"pas", "pascal"}, {"pp", "pascal"}, {"dpr", "pascal"}, {"lpr", "pascal"},
+        {"tex", "LaTeX"}, {"sty", "LaTeX"}, {"cls", "LaTeX"},
+        {"diff", "diff"}, {"patch", "diff"},
+        {"log", "log"},
+        {"desktop", "desktop"},
+        {"ini", "config"}, {"conf", "config"}, {"cfg", "config"},
+        {"theme", "theme"},
+        {"srt", "srt"},
+        {"m3u", "m3u"}, {"m3u8", "m3u"},
+        {"fountain", "fountain"},
+        {"url", "url"},
+        {"pro", "qmake"}, {"pri", "qmake"},
+        {"mk", "makefile"}, {"make", "makefile"},
+        {"1", "troff"}, {"2", "troff"}, {"3", "troff"}, {"5", "troff"}, {"8", "troff"}
+    };
+
+    if (!baseName.contains ('.'))
+        return QString();
+    return suffixes.value (baseName.section ('.', -1));
+}
@@ -210,7 +210,7 @@ void Highlighter::highlightLuaBlock (const QString &text)
     multiLineLuaComment (text);
 
     int bn = currentBlock().blockNumber();
-    if (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber())
+    if (isInLimits (bn))
     {
         data->setHighlighted(); // completely highlighted
         QRegularExpressionMatch match;
@@ -510,7 +510,7 @@ void Highlighter::highlightMarkdownBlock (const QString &text)
     }
 
     int bn = currentBlock().blockNumber();
-    if (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber())
+    if (isInLimits (bn))
     {
         data->setHighlighted(); // completely highlighted
         QRegularExpressionMatch match;
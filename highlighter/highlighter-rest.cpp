@@ -264,7 +264,7 @@ void Highlighter::highlightReSTBlock (const QString &text)
     * reST Main Formatting *
     ************************/
     int bn = currentBlock().blockNumber();
-    if (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber())
+    if (isInLimits (bn))
         reSTMainFormatting (0, text);
 
     /*********************************************
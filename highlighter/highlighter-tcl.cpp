@@ -177,7 +177,7 @@ void Highlighter::highlightTclBlock (const QString &text)
     singleLineComment (text, 0);
     multiLineTclQuote (text);
     int bn = currentBlock().blockNumber();
-    if (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber())
+    if (isInLimits (bn))
     {
         data->setHighlighted();
         QRegularExpressionMatch match;
@@ -557,7 +557,7 @@ void Highlighter::highlightXmlBlock (const QString &text)
     }
 
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isInLimits (bn));
     if (mainFormatting)
         setFormat (0, txtL, mainFormat);
 
@@ -278,7 +278,7 @@ void Highlighter::highlightYamlBlock (const QString &text)
 
     /* yaml main Formatting */
     int bn = currentBlock().blockNumber();
-    if (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber())
+    if (isInLimits (bn))
     {
         data->setHighlighted();
         QRegularExpressionMatch match;
@@ -18,6 +18,7 @@
  */
 
 #include "highlighter.h"
+#include "trace.h"
 #include <QTextDocument>
 
 Q_DECLARE_METATYPE(QTextBlock)
@@ -207,8 +208,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
     /* for highlighting next block inside highlightBlock() when needed */
     qRegisterMetaType<QTextBlock>();
 
-    startCursor = start;
-    endCursor = end;
+    setLimit (start, end);
     progLan = lang;
 
     /* whether multiLineQuote() should be used in a normal way */
@@ -1829,6 +1829,25 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         commentStartExpression.setPattern ("=begin\\s*$");
         commentEndExpression.setPattern ("^=end\\s*$");
     }
+
+    /* Highlighters of a language share their rules, and with them the
+       patterns compiled on first use, so documents opened later in the
+       same language do not compile them again (GUI thread only). The
+       rules are still built above, as the formats set along with them
+       are needed, but only those of the first highlighter are kept;
+       building them is cheap next to compiling their patterns. */
+    if (syntaxColors.isEmpty())
+    {
+        static QHash<QString, QVector<HighlightingRule> > sharedRules;
+        const QString key = progLan + (darkColorScheme ? "/dark/" : "/light/")
+                            + (showWhiteSpace ? "spaces/" : "/")
+                            + QString::number (whitespaceValue);
+        auto it = sharedRules.constFind (key);
+        if (it != sharedRules.constEnd())
+            highlightingRules = it.value();
+        else
+            sharedRules.insert (key, highlightingRules);
+    }
 }
 /*************************/
 Highlighter::~Highlighter()
@@ -1844,6 +1863,16 @@ Highlighter::~Highlighter()
     }
 }
 /*************************/
+bool Highlighter::isInLimits (int blockNumber) const
+{
+    for (const QPair<QTextCursor, QTextCursor> &limit : limits)
+    {
+        if (blockNumber >= limit.first.blockNumber() && blockNumber <= limit.second.blockNumber())
+            return true;
+    }
+    return false;
+}
+/*************************/
 // Should be used only with characters that can be escaped in a language.
 bool Highlighter::isEscapedChar (const QString &text, const int pos) const
 {
@@ -3955,6 +3984,14 @@ void Highlighter::highlightBlock (const QString &text)
 {
     if (progLan.isEmpty()) return;
 
+    TraceSpan span ("highlight", "highlightBlock");
+    if (span.isActive())
+    {
+        span.arg ("block", currentBlock().blockNumber());
+        span.arg ("length", text.length());
+        span.arg ("lang", progLan);
+    }
+
     if (progLan == "json")
     { // Json's huge lines are also handled separately because of its special syntax
         highlightJsonBlock (text);
@@ -3967,7 +4004,7 @@ void Highlighter::highlightBlock (const QString &text)
     }
 
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isInLimits (bn));
 
     int txtL = text.length();
     if (txtL <= 10000)
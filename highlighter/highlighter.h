@@ -113,15 +113,23 @@ public:
                  const QHash<QString, QColor> &syntaxColors = QHash<QString, QColor>());
     ~Highlighter();
 
+    static QString languageForFile (const QString &fileName);
+
     void setLimit (const QTextCursor &start, const QTextCursor &end) {
-        startCursor = start;
-        endCursor = end;
+        limits.clear();
+        limits.append (qMakePair (start, end));
+    }
+    /* With several views of the document, the visible text of each;
+       blocks in any of them get the main formatting. */
+    void setLimits (const QVector<QPair<QTextCursor, QTextCursor> > &ranges) {
+        limits = ranges;
     }
 
 protected:
     void highlightBlock (const QString &text);
 
 private:
+    bool isInLimits (int blockNumber) const;
     QStringList keywords (const QString &lang);
     QStringList types();
     bool isEscapedChar (const QString &text, const int pos) const;
@@ -339,8 +347,8 @@ private:
     QRegularExpression cppLiteralStart;
     QColor Blue, DarkBlue, Red, DarkRed, Verda, DarkGreen, DarkGreenAlt, Magenta, DarkMagenta, Violet, Brown, DarkYellow;
 
-    /* The start and end cursors of the visible text: */
-    QTextCursor startCursor, endCursor;
+    /* The start and end cursors of the visible text, one pair per view: */
+    QVector<QPair<QTextCursor, QTextCursor> > limits;
 
     bool multilineQuote_;
     bool mixedQuotes_;
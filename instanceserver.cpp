@@ -0,0 +1,289 @@
+#include "instanceserver.h"
+#include "trace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// A request larger than this is not from mousepad.
+static const int maxRequest = 1024 * 1024;
+// How long a launch waits for a busy instance before starting on its own.
+static const int replyTimeout = 5;
+
+#ifdef Q_OS_UNIX
+static bool socketAddress(const QByteArray &path, sockaddr_un *address)
+{
+    if (path.size() >= int(sizeof(address->sun_path)))
+        return false;
+    std::memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    std::memcpy(address->sun_path, path.constData(), path.size());
+    return true;
+}
+
+static int unixSocket()
+{
+    int handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (handle >= 0)
+        ::fcntl(handle, F_SETFD, FD_CLOEXEC);
+    return handle;
+}
+
+/* Whether the other end of a connected socket runs as this user. Where
+   that cannot be found out, it is never taken to be so. */
+static bool peerIsUser(int handle)
+{
+#if defined(Q_OS_LINUX)
+    ucred peer;
+    socklen_t length = sizeof(peer);
+    return ::getsockopt(handle, SOL_SOCKET, SO_PEERCRED, &peer, &length) == 0 && peer.uid == ::getuid();
+#elif defined(Q_OS_BSD4)
+    uid_t uid;
+    gid_t gid;
+    return ::getpeereid(handle, &uid, &gid) == 0 && uid == ::getuid();
+#else
+    Q_UNUSED(handle);
+    return false;
+#endif
+}
+
+static bool writeAll(int handle, const char *data, int size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(handle, data, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+#endif
+
+InstanceServer::InstanceServer(QObject *parent) : QObject(parent),
+    handle(-1),
+    notifier(nullptr)
+{
+}
+
+InstanceServer::~InstanceServer()
+{
+#ifdef Q_OS_UNIX
+    for (int client : clients.keys())
+        closeClient(client);
+    if (handle >= 0) {
+        ::close(handle);
+        ::unlink(socketPath().constData());
+    }
+#endif
+}
+
+QByteArray InstanceServer::socketPath()
+{
+#ifdef Q_OS_UNIX
+    /* the runtime directory is private to the user; /tmp is not, so the
+       name carries the user and each end checks the user of the other */
+    QByteArray directory = qgetenv("XDG_RUNTIME_DIR");
+    if (directory.isEmpty())
+        directory = "/tmp";
+    return directory + "/mousepad-" + QByteArray::number(uint(::getuid())) + ".socket";
+#else
+    return QByteArray();
+#endif
+}
+
+bool InstanceServer::listen()
+{
+#ifdef Q_OS_UNIX
+    if (handle >= 0)
+        return true;
+    const QByteArray path = socketPath();
+    sockaddr_un address;
+    if (!socketAddress(path, &address))
+        return false;
+    int server = unixSocket();
+    if (server < 0)
+        return false;
+    if (::bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        if (errno != EADDRINUSE) {
+            ::close(server);
+            return false;
+        }
+        /* left behind by an instance that crashed, unless one answers */
+        int probe = unixSocket();
+        bool answered = ::connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+        ::close(probe);
+        if (answered) {
+            ::close(server);
+            return false;
+        }
+        ::unlink(path.constData());
+        if (::bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            ::close(server);
+            return false;
+        }
+    }
+    if (::listen(server, 8) != 0) {
+        ::close(server);
+        ::unlink(path.constData());
+        return false;
+    }
+    ::fcntl(server, F_SETFL, ::fcntl(server, F_GETFL) | O_NONBLOCK);
+    handle = server;
+    notifier = new QSocketNotifier(handle, QSocketNotifier::Read, this);
+    connect(notifier, QOverload<QSocketDescriptor, QSocketNotifier::Type>::of(&QSocketNotifier::activated),
+            this, [this] { acceptConnection(); });
+    return true;
+#else
+    return false;
+#endif
+}
+
+void InstanceServer::acceptConnection()
+{
+#ifdef Q_OS_UNIX
+    for (;;) {
+        int client = ::accept(handle, nullptr, nullptr);
+        if (client < 0)
+            return;
+        ::fcntl(client, F_SETFD, FD_CLOEXEC);
+        ::fcntl(client, F_SETFL, ::fcntl(client, F_GETFL) | O_NONBLOCK);
+        if (!peerIsUser(client)) {
+            ::close(client);
+            continue;
+        }
+        QSocketNotifier *reader = new QSocketNotifier(client, QSocketNotifier::Read, this);
+        connect(reader, QOverload<QSocketDescriptor, QSocketNotifier::Type>::of(&QSocketNotifier::activated),
+                this, [this, client] { readRequest(client); });
+        clients.insert(client, reader);
+    }
+#endif
+}
+
+void InstanceServer::readRequest(int client)
+{
+#ifdef Q_OS_UNIX
+    QByteArray &request = requests[client];
+    char buffer[4096];
+    for (;;) {
+        ssize_t size = ::read(client, buffer, sizeof(buffer));
+        if (size > 0) {
+            request.append(buffer, int(size));
+            continue;
+        }
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size < 0 && errno == EAGAIN)
+            break;
+        closeClient(client); // closed before the request was complete
+        return;
+    }
+    if (request.size() < 8)
+        return;
+    if (!request.startsWith("MPOP")) {
+        closeClient(client);
+        return;
+    }
+    const uchar *bytes = reinterpret_cast<const uchar *>(request.constData());
+    const quint32 length = bytes[4] | bytes[5] << 8 | bytes[6] << 16 | quint32(bytes[7]) << 24;
+    if (length > quint32(maxRequest)) {
+        closeClient(client);
+        return;
+    }
+    if (quint32(request.size()) < 8 + length)
+        return;
+
+    TraceSpan span("app", "forwardedRequest");
+    QList<QByteArray> fields = request.mid(8, length).split('\0');
+    fields.removeLast(); // after the last NUL
+    writeAll(client, "OK", 2);
+    closeClient(client);
+    if (fields.isEmpty())
+        return;
+
+    const QDir directory(QFile::decodeName(fields.takeFirst()));
+    QStringList fileNames;
+    for (const QByteArray &field : fields)
+        fileNames.append(QDir::cleanPath(directory.absoluteFilePath(QFile::decodeName(field))));
+    span.arg("files", fileNames.size());
+    emit openRequested(fileNames);
+#else
+    Q_UNUSED(client);
+#endif
+}
+
+void InstanceServer::closeClient(int client)
+{
+#ifdef Q_OS_UNIX
+    /* called from the signal of the notifier */
+    QSocketNotifier *reader = clients.take(client);
+    reader->setEnabled(false);
+    reader->deleteLater();
+    requests.remove(client);
+    ::close(client);
+#else
+    Q_UNUSED(client);
+#endif
+}
+
+bool InstanceServer::forward(int argc, char **argv)
+{
+#ifdef Q_OS_UNIX
+    sockaddr_un address;
+    if (!socketAddress(socketPath(), &address))
+        return false;
+    int client = unixSocket();
+    if (client < 0)
+        return false;
+    if (::connect(client, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        ::close(client); // nothing running, the usual case
+        return false;
+    }
+    /* in /tmp, anyone could have taken the name first */
+    if (!peerIsUser(client)) {
+        ::close(client);
+        return false;
+    }
+
+    char directory[PATH_MAX];
+    if (!::getcwd(directory, sizeof(directory))) {
+        ::close(client);
+        return false;
+    }
+    QByteArray payload(directory);
+    payload.append('\0');
+    for (int i = 1; i < argc; ++i) {
+        payload.append(argv[i]);
+        payload.append('\0');
+    }
+    const quint32 length = payload.size();
+    char header[8] = { 'M', 'P', 'O', 'P', char(length), char(length >> 8), char(length >> 16), char(length >> 24) };
+
+    timeval timeout = { replyTimeout, 0 };
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char reply[2] = { 0, 0 };
+    bool taken = writeAll(client, header, sizeof(header))
+            && writeAll(client, payload.constData(), payload.size())
+            && ::recv(client, reply, sizeof(reply), MSG_WAITALL) == 2
+            && std::memcmp(reply, "OK", 2) == 0;
+    ::close(client);
+    return taken;
+#else
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+    return false;
+#endif
+}
@@ -0,0 +1,52 @@
+#ifndef INSTANCESERVER_H
+#define INSTANCESERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QSocketNotifier;
+QT_END_NAMESPACE
+
+/* Lets later launches hand their files to a running mousepad instead of
+   starting up another one. The running instance listens on a Unix socket
+   in the runtime directory. A launch calls forward() first thing in
+   main(), before any Qt object exists, so it only costs a connect() and
+   a short write when an instance is there.
+
+   A request is "MPOP", the 32-bit little-endian length of the rest, then
+   the working directory and the arguments, each ended by a NUL byte. The
+   instance answers "OK" once it has taken them. */
+class InstanceServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InstanceServer(QObject *parent = nullptr);
+    ~InstanceServer();
+
+    /* Fails if another instance is already listening. */
+    bool listen();
+
+    /* Returns true if a running instance took the arguments. */
+    static bool forward(int argc, char **argv);
+
+signals:
+    /* Absolute file names, in the order they were given. */
+    void openRequested(const QStringList &fileNames);
+
+private:
+    static QByteArray socketPath();
+    void acceptConnection();
+    void readRequest(int client);
+    void closeClient(int client);
+
+    int handle;
+    QSocketNotifier *notifier;
+    QHash<int, QSocketNotifier *> clients;
+    QHash<int, QByteArray> requests; // the part read so far
+};
+
+#endif
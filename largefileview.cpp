@@ -0,0 +1,735 @@
+#include "largefileview.h"
+#include "textwriter.h"
+#include "trace.h"
+
+#include <QClipboard>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QTimer>
+
+#include <cstring>
+
+// How much of the file is indexed between two events.
+static const qint64 indexSlice = 64 << 20;
+// Lines above and below the visible ones that are highlighted with them.
+static const int windowContext = 50;
+// Longer lines are cut when they are shown.
+static const qint64 maxLineBytes = 64 * 1024;
+// Bytes at the start of a file its encoding is detected from.
+static const qint64 encodingSample = 64 * 1024;
+// Left margin of the text, in pixels.
+static const int textMargin = 4;
+// Lines a search goes through before it is left to a MatchCounter.
+static const int maxFindLines = 20000;
+// A node of the piece table.
+static const int pieceOverhead = 96;
+
+LargeFileView::LargeFileView(QFont font, QWidget *parent) : QAbstractScrollArea(parent),
+    indexTimer(new QTimer(this)),
+    editRevision(0),
+    savedRevision(0),
+    cursorLine(0),
+    cursorColumn(0),
+    encoding(TextEncoding::Utf8),
+    bomLength(0),
+    endingStyle(LineEndings::Lf),
+    convertEndings(false),
+    window(new QTextDocument(this)),
+    highlighter(nullptr),
+    windowFirst(0),
+    windowEnd(-1),
+    maxLineWidth(0)
+{
+    setFont(font);
+    window->setDefaultFont(font);
+    viewport()->setBackgroundRole(QPalette::Base);
+    viewport()->setCursor(Qt::IBeamCursor);
+    setFocusPolicy(Qt::StrongFocus);
+    lineNumberArea = new LineNumberArea(this, this);
+
+    indexTimer->setInterval(0);
+    connect(indexTimer, &QTimer::timeout, this, &LargeFileView::indexMore);
+
+    verticalScrollBar()->setSingleStep(1);
+    setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+}
+
+LargeFileView::~LargeFileView()
+{
+    delete highlighter;
+}
+
+bool LargeFileView::openFile(const QString &fileName)
+{
+    /* a save in progress may still hold the old mapping */
+    QSharedPointer<MappedFile> mapping(new MappedFile);
+    if (!mapping->open(fileName)) {
+        error = mapping->errorString();
+        return false;
+    }
+    indexTimer->stop();
+    table.clear();
+    file = mapping;
+    path = fileName;
+    editRevision = savedRevision = 0;
+
+    TextEncoding::Detection detection = TextEncoding::detect(file->data(), qMin(file->size(), encodingSample));
+    encoding = detection.encoding;
+    bomLength = detection.bomLength;
+    convertEndings = false;
+
+    /* a file with CR line endings is split at its CRs */
+    LineEndings sample;
+    sample.scan(file->data(), qMin(file->size(), encodingSample));
+    sample.finish();
+    index.reset(file->data(), file->size(), sample.dominant() == LineEndings::Cr ? '\r' : '\n');
+    undoStack.clear();
+    redoStack.clear();
+    cursorLine = 0;
+    cursorColumn = 0;
+    windowEnd = -1;
+    maxLineWidth = 0;
+    /* enough for the first screen; the rest is indexed in the background */
+    if (index.scan(1 << 20))
+        table.reset(file->data(), file->size(), &index);
+    else
+        indexTimer->start();
+    updateScrollBars();
+    verticalScrollBar()->setValue(0);
+    viewport()->update();
+    return true;
+}
+
+void LargeFileView::setLanguage(const QString &lang)
+{
+    this->lang = lang;
+    delete highlighter;
+    highlighter = nullptr;
+    windowEnd = -1;
+    viewport()->update();
+}
+
+void LargeFileView::indexMore()
+{
+    TraceSpan span("io", "indexLines");
+    qint64 from = index.scannedBytes();
+    qint64 oldCount = index.lineCount();
+    bool done = index.scan(indexSlice);
+    file->release(from, index.scannedBytes() - from);
+    span.arg("bytes", index.scannedBytes() - from);
+
+    /* the last line of the window may have been incomplete */
+    if (windowEnd >= oldCount - 1)
+        windowEnd = -1;
+    if (done) {
+        indexTimer->stop();
+        table.reset(file->data(), file->size(), &index);
+    }
+
+    updateScrollBars();
+    viewport()->update();
+    lineNumberArea->update();
+    emit indexingProgress(index.scannedBytes(), index.totalBytes());
+}
+
+qint64 LargeFileView::lineCount() const
+{
+    return index.isComplete() ? table.lineCount() : index.lineCount();
+}
+
+LineEndings::Style LargeFileView::lineEndingStyle() const
+{
+    return convertEndings ? endingStyle : index.lineEndings().dominant();
+}
+
+void LargeFileView::setLineEndingStyle(LineEndings::Style style)
+{
+    endingStyle = style;
+    convertEndings = true;
+}
+
+SaveFunction LargeFileView::snapshot() const
+{
+    if (!index.isComplete())
+        return SaveFunction();
+    const QSharedPointer<MappedFile> mapping = file;
+    const QVector<PieceTable::Piece> pieces = table.pieces();
+    const QByteArray added = table.addBuffer();
+    const TextEncoding::Encoding encoding = this->encoding;
+    const LineEndings::Style style = lineEndingStyle();
+    const bool convert = convertEndings;
+    return [mapping, pieces, added, encoding, style, convert](QIODevice *device) {
+        TextWriter writer(device, encoding, style);
+        for (const PieceTable::Piece &piece : pieces) {
+            const char *data = (piece.added ? added.constData() : mapping->data()) + piece.start;
+            if (convert)
+                writer.convertBytes(data, piece.length);
+            else if (piece.added)
+                writer.copyBytes(data, piece.length);
+            else
+                writer.copyFileRange(mapping->handle(), piece.start, data, piece.length);
+        }
+        return writer.finish();
+    };
+}
+
+void LargeFileView::markSaved(int revision)
+{
+    if (revision == editRevision)
+        savedRevision = revision;
+}
+
+int LargeFileView::lineHeight() const
+{
+    return qMax(1, fontMetrics().lineSpacing());
+}
+
+int LargeFileView::visibleLineCount() const
+{
+    return viewport()->height() / lineHeight() + 1;
+}
+
+qint64 LargeFileView::memoryUsage() const
+{
+    qint64 bytes = index.lineCount() / LineIndex::Stride * qint64(sizeof(qint64));
+    if (index.isComplete())
+        bytes += table.pieceCount() * pieceOverhead + table.addBuffer().capacity();
+    for (const Edit &edit : undoStack)
+        bytes += sizeof(Edit) + edit.removed.capacity() + edit.inserted.capacity();
+    for (const Edit &edit : redoStack)
+        bytes += sizeof(Edit) + edit.removed.capacity() + edit.inserted.capacity();
+    return bytes;
+}
+
+qint64 LargeFileView::firstVisibleLine() const
+{
+    return verticalScrollBar()->value();
+}
+
+void LargeFileView::scrollToLine(qint64 line)
+{
+    verticalScrollBar()->setValue(int(qBound<qint64>(0, line, INT_MAX)));
+}
+
+void LargeFileView::lineRange(qint64 line, qint64 &start, qint64 &end) const
+{
+    if (index.isComplete()) {
+        start = table.lineStart(line);
+        end = table.lineEnd(line);
+    } else {
+        start = index.lineStart(line);
+        end = index.lineEnd(line);
+    }
+    if (line == 0)
+        start = qMin<qint64>(bomLength, end);
+}
+
+QString LargeFileView::lineText(qint64 line) const
+{
+    qint64 start, end;
+    lineRange(line, start, end);
+    qint64 length = qMin(end - start, maxLineBytes);
+    if (index.isComplete())
+        return decode(table.text(start, length));
+    return TextEncoding::decode(file->data() + start, int(length), encoding);
+}
+
+QString LargeFileView::decode(const QByteArray &bytes) const
+{
+    return TextEncoding::decode(bytes.constData(), bytes.size(), encoding);
+}
+
+QByteArray LargeFileView::encode(const QString &text) const
+{
+    return TextEncoding::encode(text, encoding);
+}
+
+QByteArray LargeFileView::encodeLines(QString text) const
+{
+    /* unless the endings are converted on saving, the bytes are saved
+       as they are, so new line breaks take the style of the file; they
+       must hold the byte that ends lines in the index in any case */
+    text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    text.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+    LineEndings::Style style = convertEndings ? LineEndings::Lf : lineEndingStyle();
+    if (!std::strchr(LineEndings::bytes(style), index.terminator()))
+        style = index.terminator() == '\r' ? LineEndings::Cr : LineEndings::Lf;
+    if (style != LineEndings::Lf)
+        text.replace(QLatin1Char('\n'), QLatin1String(LineEndings::bytes(style)));
+    return encode(text);
+}
+
+void LargeFileView::layoutLine(QTextLayout &layout) const
+{
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    option.setTabStopDistance(fontMetrics().horizontalAdvance(QLatin1Char(' ')) * 8);
+    layout.setFont(font());
+    layout.setTextOption(option);
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    if (line.isValid())
+        line.setLineWidth(1e7);
+    layout.endLayout();
+}
+
+void LargeFileView::updateScrollBars()
+{
+    /* QScrollBar is limited to int; files with more lines are cut */
+    qint64 lines = qMin<qint64>(lineCount(), INT_MAX);
+    int visible = viewport()->height() / lineHeight();
+    verticalScrollBar()->setPageStep(qMax(1, visible));
+    verticalScrollBar()->setRange(0, int(qMax<qint64>(0, lines - visible)));
+
+    horizontalScrollBar()->setSingleStep(fontMetrics().averageCharWidth());
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setRange(0, qMax(0, maxLineWidth - viewport()->width()));
+
+    int width = lineNumberAreaWidth();
+    if (width != lineNumberArea->width()) {
+        setViewportMargins(width, 0, 0, 0);
+        QRect cr = contentsRect();
+        lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), width, cr.height()));
+    }
+}
+
+void LargeFileView::prepareWindow(qint64 first, int count)
+{
+    qint64 last = qMin(first + count, lineCount());
+    qint64 minContext = first > 0 ? qMin<qint64>(first, windowContext / 5) : 0;
+    if (windowEnd >= 0 && first - windowFirst >= minContext && last <= windowEnd)
+        return;
+
+    TraceSpan span("highlight", "prepareWindow");
+    windowFirst = qMax<qint64>(0, first - windowContext);
+    windowEnd = qMin(last + windowContext, lineCount());
+    span.arg("firstLine", windowFirst);
+
+    QString text;
+    for (qint64 line = windowFirst; line < windowEnd; ++line) {
+        if (line > windowFirst)
+            text += QLatin1Char('\n');
+        text += lineText(line);
+    }
+
+    /* the highlighter is detached while the text is replaced, so that
+       it highlights the new text once, with the right limits */
+    if (highlighter)
+        highlighter->setDocument(nullptr);
+    window->setPlainText(text);
+    QTextCursor end(window);
+    end.movePosition(QTextCursor::End);
+    if (!highlighter) {
+        highlighter = new Highlighter(window, lang, QTextCursor(window), end, false, false, false, 180);
+    } else {
+        highlighter->setLimit(QTextCursor(window), end);
+        highlighter->setDocument(window);
+    }
+    highlighter->rehighlight();
+    /* blocks whose state changed are rehighlighted through queued
+       calls; repaint once those have been handled */
+    QMetaObject::invokeMethod(viewport(), "update", Qt::QueuedConnection);
+}
+
+void LargeFileView::paintEvent(QPaintEvent *event)
+{
+    TraceSpan span("paint", "LargeFileView::paintEvent");
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), palette().base());
+
+    qint64 first = firstVisibleLine();
+    int count = visibleLineCount();
+    span.arg("firstLine", first);
+    if (first >= lineCount())
+        return;
+    prepareWindow(first, count);
+
+    const int height = lineHeight();
+    const int left = textMargin - horizontalScrollBar()->value();
+    int widest = maxLineWidth;
+    for (int i = 0; i < count && first + i < lineCount(); ++i) {
+        QTextBlock block = window->findBlockByNumber(int(first + i - windowFirst));
+        QTextLayout layout(block.text());
+        layout.setFormats(block.layout()->formats());
+        layoutLine(layout);
+
+        if (first + i == cursorLine) {
+            painter.fillRect(0, i * height, viewport()->width(), height,
+                             QApplication::palette().alternateBase());
+        }
+        layout.draw(&painter, QPointF(left, i * height));
+        if (first + i == cursorLine && hasFocus())
+            layout.drawCursor(&painter, QPointF(left, i * height), cursorColumn);
+        widest = qMax(widest, int(layout.maximumWidth()) + 2 * textMargin);
+    }
+
+    if (widest != maxLineWidth) {
+        maxLineWidth = widest;
+        QTimer::singleShot(0, this, &LargeFileView::updateScrollBars);
+    }
+}
+
+int LargeFileView::lineNumberAreaWidth()
+{
+    int digits = 2;
+    qint64 max = qMax<qint64>(1, lineCount());
+    while (max >= 10) {
+        max /= 10;
+        ++digits;
+    }
+    return fontMetrics().horizontalAdvance(QLatin1Char('9')) * qMax(digits, 3);
+}
+
+void LargeFileView::lineNumberAreaPaintEvent(QPaintEvent *event)
+{
+    QPainter painter(lineNumberArea);
+    painter.fillRect(event->rect(), QApplication::palette().alternateBase());
+    painter.setPen(Qt::black);
+
+    qint64 first = firstVisibleLine();
+    const int height = lineHeight();
+    const int count = visibleLineCount();
+    for (int i = 0; i < count && first + i < lineCount(); ++i) {
+        painter.drawText(0, i * height, lineNumberArea->width() - 4, height,
+                         Qt::AlignRight, QString::number(first + i + 1));
+    }
+}
+
+qint64 LargeFileView::cursorOffset() const
+{
+    qint64 start, end;
+    lineRange(cursorLine, start, end);
+    return start + encode(lineText(cursorLine).left(cursorColumn)).size();
+}
+
+void LargeFileView::setCursorOffset(qint64 offset)
+{
+    cursorLine = table.lineAt(offset);
+    qint64 start, end;
+    lineRange(cursorLine, start, end);
+    cursorColumn = decode(table.text(start, offset - start)).size();
+}
+
+void LargeFileView::goToLine(qint64 line, int column)
+{
+    TraceSpan span("app", "goToLine");
+    span.arg("line", line);
+    /* the index finds the line from the nearest sample: no line before
+       it is decoded */
+    const int visible = visibleLineCount();
+    scrollToLine(qMax<qint64>(0, qMin(line, lineCount() - 1) - visible / 2));
+    moveCursor(line, column);
+    prepareWindow(firstVisibleLine(), visible);
+}
+
+LineSnapshot LargeFileView::lineSnapshot() const
+{
+    const QSharedPointer<MappedFile> mapping = file;
+    QVector<PieceTable::Piece> pieces;
+    QByteArray added;
+    if (index.isComplete()) {
+        pieces = table.pieces();
+        added = table.addBuffer();
+    } else {
+        /* nothing can be edited before the file is indexed */
+        const PieceTable::Piece whole = { false, 0, mapping->size() };
+        pieces.append(whole);
+    }
+    const TextEncoding::Encoding encoding = this->encoding;
+    const int bomLength = this->bomLength;
+    const char terminator = index.terminator();
+    return [mapping, pieces, added, encoding, bomLength, terminator](const LineVisitor &visit) {
+        QByteArray line; // the bytes of a line that goes on in the next piece
+        qint64 skip = bomLength;
+        for (const PieceTable::Piece &piece : pieces) {
+            const char *data = (piece.added ? added.constData() : mapping->data()) + piece.start;
+            qint64 from = qMin(skip, piece.length);
+            qint64 released = 0;
+            skip -= from;
+            while (from < piece.length) {
+                const char *newline = static_cast<const char *>(std::memchr(data + from, terminator, size_t(piece.length - from)));
+                const qint64 end = newline ? newline - data : piece.length;
+                const qint64 room = qMax<qint64>(0, maxLineBytes - line.size());
+                line.append(data + from, int(qMin(end - from, room)));
+                from = end + 1;
+                if (!newline)
+                    break;
+                if (terminator == '\n' && line.endsWith('\r'))
+                    line.chop(1);
+                if (!visit(TextEncoding::decode(line.constData(), line.size(), encoding)))
+                    return;
+                line.clear();
+                /* a scan of the whole file is not left in memory */
+                if (!piece.added && from - released >= indexSlice) {
+                    mapping->release(piece.start + released, from - released);
+                    released = from;
+                }
+            }
+            if (!piece.added)
+                mapping->release(piece.start + released, piece.length - released);
+        }
+        visit(TextEncoding::decode(line.constData(), line.size(), encoding));
+    };
+}
+
+bool LargeFileView::findMatch(const QRegularExpression &expression, MatchCounter::Jump jump)
+{
+    TraceSpan span("app", "findMatch");
+    const qint64 lines = lineCount();
+    const int step = jump == MatchCounter::Previous ? -1 : 1;
+    const qint64 count = qMin<qint64>(maxFindLines, lines + 1); // back to the cursor line
+    qint64 line = cursorLine;
+    for (qint64 i = 0; i < count; ++i, line = (line + step + lines) % lines) {
+        int found = -1;
+        QRegularExpressionMatchIterator matches = expression.globalMatch(lineText(line));
+        while (matches.hasNext()) {
+            const QRegularExpressionMatch match = matches.next();
+            const int start = match.capturedStart();
+            if (match.capturedLength() == 0 || (i == 0 && jump == MatchCounter::NoJump && start < cursorColumn)
+                    || (i == 0 && jump == MatchCounter::Next && start <= cursorColumn))
+                continue;
+            if (i == 0 && jump == MatchCounter::Previous && start >= cursorColumn)
+                break;
+            found = start;
+            if (jump != MatchCounter::Previous)
+                break;
+        }
+        if (found >= 0) {
+            span.arg("lines", i + 1);
+            goToLine(line, found);
+            return true;
+        }
+    }
+    span.arg("lines", count);
+    return false;
+}
+
+void LargeFileView::moveCursor(qint64 line, int column)
+{
+    cursorLine = qBound<qint64>(0, line, lineCount() - 1);
+    cursorColumn = qBound(0, column, lineText(cursorLine).size());
+    ensureCursorVisible();
+    viewport()->update();
+}
+
+void LargeFileView::ensureCursorVisible()
+{
+    const qint64 first = firstVisibleLine();
+    const int visible = qMax(1, viewport()->height() / lineHeight());
+    if (cursorLine < first)
+        scrollToLine(cursorLine);
+    else if (cursorLine >= first + visible)
+        scrollToLine(cursorLine - visible + 1);
+
+    QTextLayout layout(lineText(cursorLine));
+    layoutLine(layout);
+    int x = int(layout.lineAt(0).cursorToX(cursorColumn)) + textMargin;
+    int scroll = horizontalScrollBar()->value();
+    if (x < scroll + textMargin)
+        horizontalScrollBar()->setValue(x - textMargin);
+    else if (x > scroll + viewport()->width() - textMargin)
+        horizontalScrollBar()->setValue(x - viewport()->width() + textMargin);
+}
+
+/* Replaces length bytes at pos with text, as one undoable edit. With
+   merge, typing right after the previous insertion extends it. */
+void LargeFileView::replace(qint64 pos, qint64 length, const QByteArray &text, bool merge)
+{
+    if (!index.isComplete())
+        return; // read-only until indexed
+
+    Edit edit;
+    edit.pos = pos;
+    edit.removed = table.text(pos, length);
+    edit.inserted = text;
+    table.remove(pos, length);
+    table.insert(pos, text);
+    redoStack.clear();
+    ++editRevision;
+
+    if (merge && length == 0 && !undoStack.isEmpty()) {
+        Edit &last = undoStack.last();
+        if (last.removed.isEmpty() && last.pos + last.inserted.size() == pos) {
+            last.inserted += text;
+            edit.pos = -1;
+        }
+    }
+    if (edit.pos >= 0)
+        undoStack.append(edit);
+
+    setCursorOffset(pos + text.size());
+    textChanged();
+    emit edited(pos, edit.removed.size(), text);
+}
+
+void LargeFileView::applyEdit(qint64 position, qint64 removed, const QByteArray &inserted)
+{
+    replace(position, removed, inserted);
+}
+
+void LargeFileView::apply(const Edit &edit, bool reverse)
+{
+    const QByteArray &from = reverse ? edit.inserted : edit.removed;
+    const QByteArray &to = reverse ? edit.removed : edit.inserted;
+    table.remove(edit.pos, from.size());
+    table.insert(edit.pos, to);
+    ++editRevision;
+    setCursorOffset(edit.pos + to.size());
+    textChanged();
+    emit edited(edit.pos, from.size(), to);
+}
+
+void LargeFileView::undo()
+{
+    if (undoStack.isEmpty())
+        return;
+    Edit edit = undoStack.takeLast();
+    apply(edit, true);
+    redoStack.append(edit);
+}
+
+void LargeFileView::redo()
+{
+    if (redoStack.isEmpty())
+        return;
+    Edit edit = redoStack.takeLast();
+    apply(edit, false);
+    undoStack.append(edit);
+}
+
+void LargeFileView::paste()
+{
+    QString text = QApplication::clipboard()->text();
+    if (!text.isEmpty())
+        replace(cursorOffset(), 0, encodeLines(text));
+}
+
+void LargeFileView::textChanged()
+{
+    windowEnd = -1;
+    updateScrollBars();
+    ensureCursorVisible();
+    viewport()->update();
+    lineNumberArea->update();
+}
+
+void LargeFileView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    QRect cr = contentsRect();
+    lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    updateScrollBars();
+}
+
+void LargeFileView::changeEvent(QEvent *event)
+{
+    QAbstractScrollArea::changeEvent(event);
+    if (event->type() == QEvent::FontChange) {
+        window->setDefaultFont(font());
+        maxLineWidth = 0;
+        updateScrollBars();
+        viewport()->update();
+    }
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent *event)
+{
+    const int page = qMax(1, viewport()->height() / lineHeight());
+    const QString line = lineText(cursorLine);
+
+    if (event == QKeySequence::MoveToPreviousChar) {
+        if (cursorColumn > 0)
+            moveCursor(cursorLine, cursorColumn - (cursorColumn > 1 && line.at(cursorColumn - 1).isLowSurrogate() ? 2 : 1));
+        else if (cursorLine > 0)
+            moveCursor(cursorLine - 1, INT_MAX);
+    } else if (event == QKeySequence::MoveToNextChar) {
+        if (cursorColumn < line.size())
+            moveCursor(cursorLine, cursorColumn + (line.at(cursorColumn).isHighSurrogate() ? 2 : 1));
+        else if (cursorLine + 1 < lineCount())
+            moveCursor(cursorLine + 1, 0);
+    } else if (event == QKeySequence::MoveToPreviousLine) {
+        moveCursor(cursorLine - 1, cursorColumn);
+    } else if (event == QKeySequence::MoveToNextLine) {
+        moveCursor(cursorLine + 1, cursorColumn);
+    } else if (event == QKeySequence::MoveToPreviousPage) {
+        scrollToLine(firstVisibleLine() - page);
+        moveCursor(cursorLine - page, cursorColumn);
+    } else if (event == QKeySequence::MoveToNextPage) {
+        scrollToLine(firstVisibleLine() + page);
+        moveCursor(cursorLine + page, cursorColumn);
+    } else if (event == QKeySequence::MoveToStartOfLine || event == QKeySequence::MoveToStartOfBlock) {
+        moveCursor(cursorLine, 0);
+    } else if (event == QKeySequence::MoveToEndOfLine || event == QKeySequence::MoveToEndOfBlock) {
+        moveCursor(cursorLine, INT_MAX);
+    } else if (event == QKeySequence::MoveToStartOfDocument) {
+        moveCursor(0, 0);
+    } else if (event == QKeySequence::MoveToEndOfDocument) {
+        moveCursor(lineCount() - 1, INT_MAX);
+    } else if (event == QKeySequence::Undo) {
+        undo();
+    } else if (event == QKeySequence::Redo) {
+        redo();
+    } else if (event == QKeySequence::Paste) {
+        paste();
+    } else if (event->key() == Qt::Key_Backspace) {
+        qint64 pos = cursorOffset();
+        if (cursorColumn > 0) {
+            int from = cursorColumn - (cursorColumn > 1 && line.at(cursorColumn - 1).isLowSurrogate() ? 2 : 1);
+            qint64 length = encode(line.mid(from, cursorColumn - from)).size();
+            replace(pos - length, length, QByteArray());
+        } else if (cursorLine > 0 && index.isComplete()) {
+            qint64 end = table.lineEnd(cursorLine - 1);
+            replace(end, pos - end, QByteArray());
+        }
+    } else if (event == QKeySequence::Delete) {
+        qint64 pos = cursorOffset();
+        if (cursorColumn < line.size()) {
+            int count = line.at(cursorColumn).isHighSurrogate() ? 2 : 1;
+            replace(pos, encode(line.mid(cursorColumn, count)).size(), QByteArray());
+        } else if (cursorLine + 1 < lineCount() && index.isComplete()) {
+            replace(pos, table.lineStart(cursorLine + 1) - pos, QByteArray());
+        }
+    } else if (event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter) {
+        replace(cursorOffset(), 0, encodeLines(QStringLiteral("\n")));
+    } else if (!event->text().isEmpty() && event->text().at(0).isPrint()) {
+        replace(cursorOffset(), 0, encode(event->text()), true);
+    } else if (event->key() == Qt::Key_Tab) {
+        replace(cursorOffset(), 0, QByteArrayLiteral("\t"), true);
+    } else {
+        QAbstractScrollArea::keyPressEvent(event);
+    }
+}
+
+bool LargeFileView::focusNextPrevChild(bool next)
+{
+    Q_UNUSED(next);
+    return false; // Tab is text
+}
+
+void LargeFileView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton) {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+    qint64 line = firstVisibleLine() + event->pos().y() / lineHeight();
+    line = qMin(line, lineCount() - 1);
+    QTextLayout layout(lineText(line));
+    layoutLine(layout);
+    int x = event->pos().x() + horizontalScrollBar()->value() - textMargin;
+    moveCursor(line, layout.lineAt(0).xToCursor(x));
+}
+
+void LargeFileView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    viewport()->update();
+    lineNumberArea->update();
+}
@@ -0,0 +1,157 @@
+#ifndef LARGEFILEVIEW_H
+#define LARGEFILEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QSharedPointer>
+#include <QVector>
+#include "codeeditor.h"
+#include "lineindex.h"
+#include "mappedfile.h"
+#include "piecetable.h"
+#include "textencoding.h"
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+class QTextLayout;
+class QTimer;
+QT_END_NAMESPACE
+
+/* An editor for files that are too large for a QTextDocument.
+   The file is memory-mapped and indexed by lines in the background;
+   once it is indexed, edits go to a PieceTable over the mapping, so
+   the file is never copied. Only the lines on the screen are ever
+   decoded. They are highlighted inside a small window document that
+   also holds some lines above and below them, so that most multi-line
+   constructs are still recognized. */
+class LargeFileView : public QAbstractScrollArea, public LineNumberHost
+{
+    Q_OBJECT
+
+public:
+    LargeFileView(QFont font, QWidget *parent = nullptr);
+    ~LargeFileView();
+
+    bool openFile(const QString &fileName);
+    QString fileName() const { return path; }
+    void setFileName(const QString &fileName) { path = fileName; }
+    QString errorString() const { return error; }
+
+    void setLanguage(const QString &lang);
+    qint64 lineCount() const;
+    bool isIndexed() const { return index.isComplete(); }
+    bool isModified() const { return editRevision != savedRevision; }
+    /* UTF-8 or Latin-1; UTF-16 files are left to CodeEditor. */
+    TextEncoding::Encoding textEncoding() const { return encoding; }
+    /* The most common line ending of the file until another style is
+       set. The file is written with its endings as they are unless a
+       style was set. */
+    LineEndings::Style lineEndingStyle() const;
+    void setLineEndingStyle(LineEndings::Style style);
+    const LineEndings &lineEndings() const { return index.lineEndings(); }
+    /* A snapshot of the text for saving, which keeps the mapping alive
+       until it is written; a null function until the file is indexed. */
+    SaveFunction snapshot() const;
+    void markSaved(int revision);
+    int revision() const { return editRevision; }
+    /* Replaces removed bytes at position, for replaying a journal. */
+    void applyEdit(qint64 position, qint64 removed, const QByteArray &inserted);
+    /* The bytes held besides the mapping: the line index, the pieces,
+       what was typed and the undo history. */
+    qint64 memoryUsage() const;
+    qint64 firstVisibleLine() const;
+    void scrollToLine(qint64 line);
+    qint64 cursorLineNumber() const { return cursorLine; }
+    int cursorColumnNumber() const { return cursorColumn; }
+    /* Clamped to the lines indexed so far. */
+    void setCursorPosition(qint64 line, int column) { moveCursor(line, column); }
+    /* Sets the cursor and shows it in the middle of the view, with the
+       lines around it highlighted before they are painted. */
+    void goToLine(qint64 line, int column);
+    /* A snapshot of the text for counting matches on another thread,
+       which keeps the mapping alive; lines are cut as they are shown. */
+    LineSnapshot lineSnapshot() const;
+    /* Moves the cursor to the match at or after it, or with jump, to the
+       next or the previous one, wrapping around. Only a limited number
+       of lines is searched; returns false if none of them matches. */
+    bool findMatch(const QRegularExpression &expression, MatchCounter::Jump jump);
+
+    void lineNumberAreaPaintEvent(QPaintEvent *event) override;
+    int lineNumberAreaWidth() override;
+
+public slots:
+    void undo();
+    void redo();
+    void paste();
+
+signals:
+    void indexingProgress(qint64 scannedBytes, qint64 totalBytes);
+    /* Each change of the text, undo and redo included. */
+    void edited(qint64 position, qint64 removed, const QByteArray &inserted);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    bool focusNextPrevChild(bool next) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private slots:
+    void indexMore();
+
+private:
+    struct Edit
+    {
+        qint64 pos;
+        QByteArray removed;
+        QByteArray inserted;
+    };
+
+    int lineHeight() const;
+    int visibleLineCount() const;
+    void lineRange(qint64 line, qint64 &start, qint64 &end) const;
+    QString lineText(qint64 line) const;
+    QString decode(const QByteArray &bytes) const;
+    QByteArray encode(const QString &text) const;
+    QByteArray encodeLines(QString text) const;
+    void layoutLine(QTextLayout &layout) const;
+    void updateScrollBars();
+    void prepareWindow(qint64 first, int count);
+
+    qint64 cursorOffset() const;
+    void setCursorOffset(qint64 offset);
+    void moveCursor(qint64 line, int column);
+    void ensureCursorVisible();
+    void replace(qint64 pos, qint64 length, const QByteArray &text, bool merge = false);
+    void apply(const Edit &edit, bool reverse);
+    void textChanged();
+
+    QSharedPointer<MappedFile> file;
+    QString path;
+    QString error;
+    int editRevision;
+    int savedRevision;
+    LineIndex index;
+    PieceTable table; // used once the index is complete
+    QTimer *indexTimer;
+    LineNumberArea *lineNumberArea;
+
+    qint64 cursorLine;
+    int cursorColumn; // in QChars of the decoded line
+    TextEncoding::Encoding encoding;
+    int bomLength;
+    LineEndings::Style endingStyle;
+    bool convertEndings;
+    QVector<Edit> undoStack;
+    QVector<Edit> redoStack;
+
+    QTextDocument *window;
+    Highlighter *highlighter;
+    QString lang;
+    qint64 windowFirst;
+    qint64 windowEnd; // -1 when the window has to be rebuilt
+    int maxLineWidth;
+};
+
+#endif
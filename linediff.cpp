@@ -0,0 +1,111 @@
+#include "linediff.h"
+
+#include <QString>
+
+#include <vector>
+
+quint64 LineDiff::hash(const QChar *text, int length)
+{
+    quint64 h = Q_UINT64_C(14695981039346656037);
+    for (int i = 0; i < length; ++i) {
+        h ^= text[i].unicode();
+        h *= Q_UINT64_C(1099511628211);
+    }
+    return h;
+}
+
+QVector<LineDiff::Hunk> LineDiff::diff(const QVector<quint64> &oldLines, const QVector<quint64> &newLines, int maxEdits)
+{
+    QVector<Hunk> hunks;
+    const quint64 *a = oldLines.constData();
+    const quint64 *b = newLines.constData();
+    int n = oldLines.size();
+    int m = newLines.size();
+
+    int prefix = 0;
+    while (prefix < n && prefix < m && a[prefix] == b[prefix])
+        ++prefix;
+    while (n > prefix && m > prefix && a[n - 1] == b[m - 1]) {
+        --n;
+        --m;
+    }
+    a += prefix;
+    b += prefix;
+    n -= prefix;
+    m -= prefix;
+    if (n == 0 && m == 0)
+        return hunks;
+
+    /* v[k] is the furthest x reached on diagonal k = x - y; a copy is
+       kept after each round d for the way back */
+    const int limit = qMin(n + m, maxEdits);
+    const int offset = limit + 1;
+    std::vector<int> v(size_t(2 * limit + 3), 0);
+    std::vector<std::vector<int>> trace;
+    int edits = -1;
+    for (int d = 0; d <= limit && edits < 0; ++d) {
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v[size_t(offset + k - 1)] < v[size_t(offset + k + 1)]))
+                x = v[size_t(offset + k + 1)];
+            else
+                x = v[size_t(offset + k - 1)] + 1;
+            int y = x - k;
+            while (x < n && y < m && a[x] == b[y]) {
+                ++x;
+                ++y;
+            }
+            v[size_t(offset + k)] = x;
+            if (x >= n && y >= m) {
+                edits = d;
+                break;
+            }
+        }
+        trace.push_back(v);
+    }
+
+    if (edits < 0) {
+        Hunk hunk = { prefix, n, prefix, m };
+        hunks.append(hunk);
+        return hunks;
+    }
+
+    /* walk back from the end, keeping the matched lines */
+    std::vector<int> matchedX, matchedY;
+    int x = n;
+    int y = m;
+    for (int d = edits; d >= 0; --d) {
+        int prevX = 0, prevY = 0;
+        if (d > 0) {
+            const std::vector<int> &prev = trace[size_t(d - 1)];
+            const int k = x - y;
+            const int prevK = (k == -d || (k != d && prev[size_t(offset + k - 1)] < prev[size_t(offset + k + 1)])) ? k + 1 : k - 1;
+            prevX = prev[size_t(offset + prevK)];
+            prevY = prevX - prevK;
+        }
+        while (x > prevX && y > prevY) {
+            --x;
+            --y;
+            matchedX.push_back(x);
+            matchedY.push_back(y);
+        }
+        x = prevX;
+        y = prevY;
+    }
+
+    int fromX = 0;
+    int fromY = 0;
+    for (size_t i = matchedX.size(); i-- > 0;) {
+        if (matchedX[i] > fromX || matchedY[i] > fromY) {
+            Hunk hunk = { prefix + fromX, matchedX[i] - fromX, prefix + fromY, matchedY[i] - fromY };
+            hunks.append(hunk);
+        }
+        fromX = matchedX[i] + 1;
+        fromY = matchedY[i] + 1;
+    }
+    if (fromX < n || fromY < m) {
+        Hunk hunk = { prefix + fromX, n - fromX, prefix + fromY, m - fromY };
+        hunks.append(hunk);
+    }
+    return hunks;
+}
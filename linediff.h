@@ -0,0 +1,30 @@
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <QVector>
+
+/* A line diff of two texts given by the hashes of their lines: the
+   common prefix and suffix are skipped, then the middle is compared with
+   Myers' O(ND) algorithm. When the middle differs in more than maxEdits
+   lines, it is reported as one hunk instead, which is still correct,
+   only coarser. */
+class LineDiff
+{
+public:
+    /* Lines [oldStart, oldStart + oldCount) of the old text are replaced
+       by lines [newStart, newStart + newCount) of the new one. */
+    struct Hunk
+    {
+        int oldStart;
+        int oldCount;
+        int newStart;
+        int newCount;
+    };
+
+    static QVector<Hunk> diff(const QVector<quint64> &oldLines, const QVector<quint64> &newLines, int maxEdits = 2000);
+
+    /* FNV-1a of the UTF-16 units of a line. */
+    static quint64 hash(const QChar *text, int length);
+};
+
+#endif
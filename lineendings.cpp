@@ -0,0 +1,60 @@
+#include "lineendings.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void LineEndings::scan(const char *data, qint64 size)
+{
+    const char *p = data;
+    const char *const end = data + size;
+
+#ifdef __SSE2__
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i ret = _mm_set1_epi8('\r');
+    while (end - p >= 64) {
+        quint64 lfMask = 0, crMask = 0;
+        for (int i = 0; i < 4; ++i) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p) + i);
+            lfMask |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)))) << (16 * i);
+            crMask |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, ret)))) << (16 * i);
+        }
+        addRound(lfMask, crMask);
+        addLineFeeds(qPopulationCount(lfMask));
+        p += 64;
+    }
+#endif
+
+    while (p < end) {
+        const int width = int(qMin<qint64>(end - p, 64));
+        quint64 lfMask = 0, crMask = 0;
+        for (int i = 0; i < width; ++i) {
+            lfMask |= quint64(p[i] == '\n') << i;
+            crMask |= quint64(p[i] == '\r') << i;
+        }
+        addRound(lfMask, crMask, width);
+        addLineFeeds(qPopulationCount(lfMask));
+        p += width;
+    }
+}
+
+void LineEndings::scan(const QChar *text, int size)
+{
+    for (int done = 0; done < size; done += 64) {
+        const int width = qMin(size - done, 64);
+        quint64 lfMask = 0, crMask = 0;
+        for (int i = 0; i < width; ++i) {
+            lfMask |= quint64(text[done + i] == QLatin1Char('\n')) << i;
+            crMask |= quint64(text[done + i] == QLatin1Char('\r')) << i;
+        }
+        addRound(lfMask, crMask, width);
+        addLineFeeds(qPopulationCount(lfMask));
+    }
+}
+
+void LineEndings::finish()
+{
+    if (pendingCr)
+        ++cr;
+    pendingCr = false;
+}
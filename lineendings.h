@@ -0,0 +1,75 @@
+#ifndef LINEENDINGS_H
+#define LINEENDINGS_H
+
+#include <QString>
+#include <QtAlgorithms>
+
+/* Counts of the line endings of a text, fed in any number of pieces.
+   A CR at the end of a piece is held until the next one tells whether
+   it starts a CRLF. */
+class LineEndings
+{
+public:
+    enum Style { Lf, CrLf, Cr };
+
+    LineEndings() : lf(0), crlf(0), cr(0), pendingCr(false) {}
+
+    void scan(const char *data, qint64 size);
+    void scan(const QChar *text, int size);
+    /* Call at the end of the text. */
+    void finish();
+
+    /* The two halves of scan() for callers that have their own loop:
+       the LF and CR bit masks of up to 64 consecutive bytes, which pair
+       the CRs, and the number of LFs, which is all that is needed of
+       text without CRs. */
+    void addRound(quint64 lfMask, quint64 crMask, int width = 64)
+    {
+        if (!crMask && !pendingCr)
+            return;
+        if (pendingCr) {
+            if (lfMask & 1)
+                ++crlf;
+            else
+                ++cr;
+        }
+        const quint64 pairs = crMask & (lfMask >> 1);
+        const quint64 last = Q_UINT64_C(1) << (width - 1);
+        pendingCr = crMask & last;
+        crlf += qPopulationCount(pairs);
+        cr += qPopulationCount(crMask & ~pairs & ~last);
+    }
+    void addLineFeeds(qint64 count) { lf += count; }
+
+    qint64 lfCount() const { return lf - crlf; }
+    qint64 crlfCount() const { return crlf; }
+    qint64 crCount() const { return cr; }
+
+    /* The most common ending; LF when there is none. */
+    Style dominant() const
+    {
+        if (crlf > lfCount() && crlf >= cr)
+            return CrLf;
+        if (cr > lfCount() && cr > crlf)
+            return Cr;
+        return Lf;
+    }
+    bool isMixed() const { return (lfCount() > 0) + (crlf > 0) + (cr > 0) > 1; }
+
+    static const char *bytes(Style style)
+    {
+        return style == CrLf ? "\r\n" : style == Cr ? "\r" : "\n";
+    }
+    static QString name(Style style)
+    {
+        return style == CrLf ? QStringLiteral("CRLF") : style == Cr ? QStringLiteral("CR") : QStringLiteral("LF");
+    }
+
+private:
+    qint64 lf; // all LFs, including those of CRLFs
+    qint64 crlf;
+    qint64 cr;
+    bool pendingCr;
+};
+
+#endif
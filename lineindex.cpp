@@ -0,0 +1,122 @@
+#include "lineindex.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+LineIndex::LineIndex() :
+    data(nullptr),
+    size(0),
+    scanned(0),
+    newlines(0),
+    breakByte('\n')
+{
+}
+
+void LineIndex::reset(const char *data, qint64 size, char terminator)
+{
+    this->data = data;
+    this->size = size;
+    breakByte = terminator;
+    scanned = 0;
+    newlines = 0;
+    endings = LineEndings();
+    samples.clear();
+    samples.append(0);
+}
+
+bool LineIndex::scan(qint64 maxBytes)
+{
+    const char *p = data + scanned;
+    const char *const end = data + qMin(size, scanned + maxBytes);
+    const qint64 oldNewlines = newlines;
+    const bool lf = breakByte == '\n';
+
+#ifdef __SSE2__
+    /* 64 bytes per round */
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i ret = _mm_set1_epi8('\r');
+    while (end - p >= 64) {
+        quint64 lfMask = 0, crMask = 0;
+        for (int i = 0; i < 4; ++i) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p) + i);
+            lfMask |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)))) << (16 * i);
+            crMask |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, ret)))) << (16 * i);
+        }
+        endings.addRound(lfMask, crMask);
+        if (!lf)
+            endings.addLineFeeds(qPopulationCount(lfMask));
+        addTerminators(p - data, lf ? lfMask : crMask);
+        p += 64;
+    }
+#endif
+
+    while (p < end) {
+        const int width = int(qMin<qint64>(end - p, 64));
+        quint64 lfMask = 0, crMask = 0;
+        for (int i = 0; i < width; ++i) {
+            lfMask |= quint64(p[i] == '\n') << i;
+            crMask |= quint64(p[i] == '\r') << i;
+        }
+        endings.addRound(lfMask, crMask, width);
+        if (!lf)
+            endings.addLineFeeds(qPopulationCount(lfMask));
+        addTerminators(p - data, lf ? lfMask : crMask);
+        p += width;
+    }
+    scanned = p - data;
+    if (lf)
+        endings.addLineFeeds(newlines - oldNewlines);
+    if (isComplete())
+        endings.finish();
+    return isComplete();
+}
+
+qint64 LineIndex::lineStart(qint64 line) const
+{
+    if (line <= 0)
+        return 0;
+    line = qMin(line, newlines);
+    qint64 offset = samples.at(int(line / Stride));
+    for (qint64 i = line % Stride; i > 0; --i) {
+        const void *nl = std::memchr(data + offset, breakByte, size_t(scanned - offset));
+        offset = static_cast<const char *>(nl) - data + 1;
+    }
+    return offset;
+}
+
+qint64 LineIndex::lineEnd(qint64 line) const
+{
+    qint64 start = lineStart(line);
+    qint64 end = size;
+    if (line < newlines) {
+        const void *nl = std::memchr(data + start, breakByte, size_t(scanned - start));
+        end = static_cast<const char *>(nl) - data;
+    }
+    if (breakByte == '\n' && end > start && data[end - 1] == '\r')
+        --end;
+    return end;
+}
+
+qint64 LineIndex::lineAt(qint64 offset) const
+{
+    offset = qBound(Q_INT64_C(0), offset, scanned);
+    /* the last sample starting at or before offset */
+    int i = int(std::upper_bound(samples.constBegin(), samples.constEnd(), offset) - samples.constBegin()) - 1;
+    qint64 line = qint64(i) * Stride;
+    const char *p = data + samples.at(i);
+    const char *const target = data + offset;
+    while (p < target) {
+        const void *nl = std::memchr(p, breakByte, size_t(target - p));
+        if (!nl)
+            break;
+        p = static_cast<const char *>(nl) + 1;
+        ++line;
+    }
+    return line;
+}
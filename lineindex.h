@@ -0,0 +1,77 @@
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <QVector>
+#include "lineendings.h"
+
+/* The line starts of a text buffer, built by a vectorized newline scan.
+   Only the start of every Stride-th line is stored; the others are
+   found with a short memchr() walk from the nearest sample. This keeps
+   the index of a 4 GB log at a few MB. The scan can be done in slices,
+   so a view can show the beginning of a file before it is indexed.
+
+   Lines end at LF, or in text with CR line endings, at CR: the byte
+   that ends lines is chosen up front, from a sample of the text. */
+class LineIndex
+{
+public:
+    enum { Stride = 64 };
+
+    LineIndex();
+
+    void reset(const char *data, qint64 size, char terminator = '\n');
+    /* Indexes up to maxBytes more; returns true once the buffer is done. */
+    bool scan(qint64 maxBytes);
+
+    bool isComplete() const { return scanned >= size; }
+    qint64 scannedBytes() const { return scanned; }
+    qint64 totalBytes() const { return size; }
+    /* The byte that ends lines, '\n' or '\r'. */
+    char terminator() const { return breakByte; }
+
+    /* The number of lines known so far. A final terminator starts an
+       empty last line, as in QTextDocument. */
+    qint64 lineCount() const { return newlines + 1; }
+    /* The kinds of line endings seen so far. Only the terminator starts
+       lines in the index, so with LF, lone CRs do not, and with CR,
+       LFs do not. */
+    const LineEndings &lineEndings() const { return endings; }
+    /* Byte offset of the first character of a line. */
+    qint64 lineStart(qint64 line) const;
+    /* Byte offset just after the last character of a line, that is,
+       of its terminator ("\n", "\r\n" or "\r") or of the end of the
+       buffer. */
+    qint64 lineEnd(qint64 line) const;
+    /* The line containing the byte at offset. */
+    qint64 lineAt(qint64 offset) const;
+
+private:
+    /* Counts the terminators in mask, the bits of the 64 bytes from
+       base; the exact positions are only needed when they contain the
+       start of a sampled line. */
+    void addTerminators(qint64 base, quint64 mask)
+    {
+        if (!mask)
+            return;
+        const qint64 count = qPopulationCount(mask);
+        if ((newlines % Stride) + count < Stride) {
+            newlines += count;
+            return;
+        }
+        while (mask) {
+            if (++newlines % Stride == 0)
+                samples.append(base + qCountTrailingZeroBits(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+
+    const char *data;
+    qint64 size;
+    qint64 scanned;
+    qint64 newlines; // terminators, not only LFs
+    char breakByte;
+    QVector<qint64> samples; // samples[i] is the start of line i * Stride
+    LineEndings endings;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "logfollower.h"
+#include "trace.h"
+
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+// Read at most this much before letting the window repaint.
+static const int maxReadSize = 4 << 20;
+// Writes within this many milliseconds are read together.
+static const int readDelay = 20;
+
+LogFollower::LogFollower(QObject *parent) : QObject(parent),
+    watcher(new QFileSystemWatcher(this)),
+    readTimer(new QTimer(this)),
+    pollTimer(new QTimer(this)),
+    encoding(TextEncoding::Utf8),
+    offset(0),
+    heldCr(false)
+{
+    readTimer->setSingleShot(true);
+    pollTimer->setInterval(1000);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &LogFollower::fileChanged);
+    connect(readTimer, &QTimer::timeout, this, &LogFollower::readMore);
+    connect(pollTimer, &QTimer::timeout, this, &LogFollower::fileChanged);
+}
+
+bool LogFollower::follow(const QString &fileName, qint64 offset, TextEncoding::Encoding encoding)
+{
+    stop();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return false;
+    this->encoding = encoding;
+    this->offset = offset;
+    watcher->addPath(fileName);
+    readMore(); // what was written since the file was loaded
+    return true;
+}
+
+qint64 LogFollower::shownBytes() const
+{
+    const int crBytes = encoding == TextEncoding::Utf16LE || encoding == TextEncoding::Utf16BE ? 2 : 1;
+    return offset - pending.size() - (heldCr ? crBytes : 0);
+}
+
+void LogFollower::stop()
+{
+    if (!watcher->files().isEmpty())
+        watcher->removePaths(watcher->files());
+    readTimer->stop();
+    pollTimer->stop();
+    file.close();
+    pending.clear();
+    heldCr = false;
+}
+
+void LogFollower::fileChanged()
+{
+    if (!isFollowing())
+        return;
+    /* a file that is renamed or deleted is no longer watched */
+    if (!watcher->files().contains(file.fileName())) {
+        if (!QFileInfo::exists(file.fileName())) {
+            pollTimer->start();
+            return;
+        }
+        pollTimer->stop();
+        stop();
+        emit truncated();
+        return;
+    }
+    if (!readTimer->isActive())
+        readTimer->start(readDelay);
+}
+
+void LogFollower::readMore()
+{
+    if (!isFollowing())
+        return;
+    const qint64 size = file.size();
+    if (size < offset) {
+        stop();
+        emit truncated();
+        return;
+    }
+    if (size == offset)
+        return;
+
+    TraceSpan span("io", "followFile");
+    if (!file.seek(offset))
+        return;
+    QByteArray bytes = file.read(qMin<qint64>(size - offset, maxReadSize));
+    offset += bytes.size();
+    span.arg("bytes", bytes.size());
+
+    /* a write may end in the middle of a character */
+    pending += bytes;
+    int length = TextEncoding::completeLength(pending.constData(), pending.size(), encoding);
+    QString text = TextEncoding::decode(pending.constData(), length, encoding);
+    pending.remove(0, length);
+
+    /* a CR is kept until it is known whether it starts a CRLF */
+    if (heldCr)
+        text.prepend(QLatin1Char('\r'));
+    heldCr = text.endsWith(QLatin1Char('\r'));
+    if (heldCr)
+        text.chop(1);
+    if (!text.isEmpty())
+        emit appended(text);
+
+    if (offset < size)
+        readTimer->start(0);
+}
@@ -0,0 +1,56 @@
+#ifndef LOGFOLLOWER_H
+#define LOGFOLLOWER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QObject>
+#include "textencoding.h"
+
+QT_BEGIN_NAMESPACE
+class QFileSystemWatcher;
+class QTimer;
+QT_END_NAMESPACE
+
+/* Follows a file that only grows, such as a log, like tail -f. Writes
+   are noticed by QFileSystemWatcher, which uses inotify on Linux, and
+   only the bytes after the part already shown are read and decoded.
+   Bursts of writes are read together, a few megabytes per event loop
+   pass, so a fast writer cannot starve the window. */
+class LogFollower : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LogFollower(QObject *parent = nullptr);
+
+    /* Starts at offset, the size of the part that is already shown. */
+    bool follow(const QString &fileName, qint64 offset, TextEncoding::Encoding encoding);
+    void stop();
+    bool isFollowing() const { return file.isOpen(); }
+    /* The size of the part shown so far, where following can go on
+       after stop(); a partial character or a held CR is not shown. */
+    qint64 shownBytes() const;
+    QString fileName() const { return file.fileName(); }
+
+signals:
+    void appended(const QString &text);
+    /* The file got shorter or was replaced, by a log rotation for
+       example; it has to be read again from the start. */
+    void truncated();
+
+private slots:
+    void fileChanged();
+    void readMore();
+
+private:
+    QFileSystemWatcher *watcher;
+    QTimer *readTimer;
+    QTimer *pollTimer; // while the file is gone
+    QFile file;
+    TextEncoding::Encoding encoding;
+    qint64 offset;
+    QByteArray pending;
+    bool heldCr;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <QApplication>
+#include <QActionGroup>
 #include <QComboBox>
 #include <QMainWindow>
 #include <QPlainTextEdit>
@@ -7,9 +8,11 @@
 #include <QHBoxLayout>
 #include <QFormLayout>
 #include <QDialogButtonBox>
+#include <QElapsedTimer>
 #include <QGroupBox>
 #include <QCheckBox>
 #include <QSpinBox>
+#include <QSplitter>
 #include <QToolBar>
 #include <QPushButton>
 #include <QLineEdit>
@@ -17,26 +20,1142 @@
 #include <QFontDialog>
 #include <QSettings>
 #include <QErrorMessage>
+#include <QEventLoop>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHash>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPointer>
+#include <QProgressBar>
+#include <QScrollBar>
+#include <QStatusBar>
+#include <QStackedWidget>
+#include <QTabBar>
+#include <QTabWidget>
+#include <QTextBlock>
+#include <QTimer>
+#include "asyncsaver.h"
 #include "codeeditor.h"
+#include "editjournal.h"
+#include "editrecorder.h"
+#include "fileloader.h"
+#include "filereloader.h"
+#include "hibernator.h"
+#include "instanceserver.h"
+#include "largefileview.h"
+#include "logfollower.h"
+#include "matchcounter.h"
+#include "session.h"
+#include "textencoding.h"
+#include "trace.h"
 
+#include <climits>
+#include <cstdio>
 #include <libintl.h>
 #include <locale.h>
 #define _(STRING) gettext(STRING)
 
 QSettings *settings;
 
-QTabWidget *prefswin; // Menubar > Edit > Preferences
-QToolBar *findToolBar; // Menubar > Search > Find
-QDialog *findnReplaceWindow; // Menubar > Search > Find and Replace
-QDialog *gotoWindow; // Menubar > Search > Go to
-QFontDialog *fontWindow; // Menubar > View > Font
-CodeEditor *editor;
+QTabWidget *prefswin; // Menubar > Edit > Preferences, built on first use
+QDialog *findnReplaceWindow; // Menubar > Search > Find and Replace, built on first use
+QDialog *gotoWindow; // Menubar > Search > Go to, built on first use
+QSpinBox *gotoLineSpinner; // Menubar > Search > Go to > Line number
+QSpinBox *gotoColumnSpinner; // Menubar > Search > Go to > Column
+QFontDialog *fontWindow; // Menubar > View > Font, built on first use
+QFont editorFont; // of every document, so they share one font engine and its metrics
+bool lineNumbersDisabled; // Menubar > View > Line numbers
+AsyncSaver *saver;
+QHash<QString, int> savingFiles; // saves of each file not finished yet
+Hibernator *hibernator; // of documents left unused in the background
+EditRecorder *recorder; // of the document shown, with MOUSEPAD_RECORD_TRACE set
+bool sessionRestored; // else the saved session is not the one open, and is kept
+InstanceServer *instanceServer; // takes the files of later launches, in single-instance mode
+QElapsedTimer startupClock; // since main() began, with MOUSEPAD_STARTUP_TIMING set
+QVector<QPair<const char *, qint64>> startupPhases; // name and end of each phase, in ns
+
+struct Window;
+
+// An open document in a tab: the editor, the view for large files, and what goes on with its file.
+struct Tab {
+	QStackedWidget *stack; // the page of the tab, showing editorPane or largeView
+	QSplitter *editorPane; // the editor, and below it splitView
+	CodeEditor *editor; // created when a file is first read into the tab
+	CodeEditor *splitView; // Menubar > View > Split View, another view of the document of editor
+	LargeFileView *largeView; // created for the first large file of the tab
+	Window *window;
+	FileLoader *loader; // the file being read into the editor, if any
+	FileReloader *reloader; // of the editor, when its file changes on disk
+	LogFollower *follower; // Menubar > View > Follow File, created on first use
+	EditJournal *journal; // crash-recovery journal of the view shown
+	EditJournal::Orphan pendingRecovery; // replayed once the document is loaded
+	qint64 fileSize; // bytes of the file in the editor, where following starts
+	bool resumeFollowing; // once the file being reloaded is loaded
+	Compression::Format compression; // of the file in the editor
+	QString encodingName; // Statusbar > encoding of the file
+	Session::Document restoringView; // put back once the document is loaded
+	Session::Document placeholder; // not read yet, or hibernating: read once the tab is shown
+	EditJournal::Orphan hibernatedChanges; // the unsaved changes of a hibernating document, read back with it
+	bool saveWhenLoaded; // Menubar > File > Save All, once the hibernated changes are read back
+	qint64 gotoLine; // Menubar > Search > Go to, once the line is loaded or indexed, or -1
+	int gotoColumn;
+};
+
+// A main window and the parts of its menus and status bar that show its current tab.
+struct Window {
+	QMainWindow *main;
+	QTabWidget *tabs;
+	QToolBar *findToolBar; // Menubar > Search > Find, built on first use
+	QLineEdit *searchBar; // Menubar > Search > Find > search box
+	QCheckBox *matchCaseCheckbox;
+	QCheckBox *regularExpressionCheckbox;
+	QLabel *matchLabel; // Menubar > Search > Find > "n of N"
+	MatchCounter *matchCounter; // of the search in the current tab
+	LineSnapshot searchSnapshot; // of the current tab, taken again once its document changes
+	QPointer<QWidget> searchSnapshotView; // the view searchSnapshot was taken of
+	int searchSnapshotRevision;
+	QLabel *loadLabel; // Statusbar > load progress
+	QProgressBar *loadProgress;
+	QPushButton *loadCancelButton;
+	QLabel *encodingLabel; // Statusbar > encoding of the file
+	QActionGroup *lineEndingGroup; // Menubar > Document > Line Ending
+	QAction *lineNumbersAction; // Menubar > View > Line numbers
+	QAction *splitAction; // Menubar > View > Split View
+	QAction *followAction; // Menubar > View > Follow File
+	QAction *compressAction; // Menubar > Document > Compress on Save
+};
+
+QList<Window *> windows; // in the order they were opened
+Window *activeWindow; // the one last activated
+QHash<QWidget *, Tab *> tabs; // by page
+
+void startupPhase(const char *name){
+	if(startupClock.isValid()) startupPhases.append(qMakePair(name, startupClock.nsecsElapsed()));
+}
+
+void reportStartup(){
+	qint64 previous = 0;
+	for(const QPair<const char *, qint64> &phase : startupPhases){
+		fprintf(stderr, "startup: %-18s %8.2f ms %8.2f ms\n", phase.first, (phase.second - previous) / 1e6, phase.second / 1e6);
+		previous = phase.second;
+	}
+	startupPhases.clear();
+	startupClock.invalidate();
+}
+
+// Ends the startup timing once the editor has painted for the first time
+class FirstPaintWatcher : public QObject {
+public:
+	using QObject::QObject;
+
+	bool eventFilter(QObject *watched, QEvent *event) override {
+		if(event->type() == QEvent::Paint){
+			watched->removeEventFilter(this);
+			startupPhase("paint event");
+			// runs once the paint event is handled
+			QTimer::singleShot(0, []{startupPhase("first paint"); reportStartup();});
+			deleteLater();
+		}
+		return false;
+	}
+};
+
+// Files from this size on are memory-mapped instead of loaded into the editor.
+const qint64 largeFileSize = 64 << 20;
+// Documents of the editor above this are not copied for journal checkpoints; their journal grows instead.
+const int maxCheckpointChars = 8 << 20;
+
+Tab *currentTab(Window *w){
+	return tabs.value(w->tabs->currentWidget());
+}
+
+bool isCurrent(Tab *tab){
+	return tab->window->tabs->currentWidget() == tab->stack;
+}
+
+bool showsLargeView(Tab *tab){
+	return tab->largeView && tab->stack->currentWidget() == tab->largeView;
+}
+
+QString fileNameOf(Tab *tab){
+	if(!tab->placeholder.fileName.isEmpty()) return tab->placeholder.fileName;
+	if(showsLargeView(tab)) return tab->largeView->fileName();
+	return tab->editor ? tab->editor->fileName() : QString();
+}
+
+bool isModified(Tab *tab){
+	if(!tab->hibernatedChanges.key.isEmpty()) return true;
+	if(showsLargeView(tab)) return tab->largeView->isModified();
+	return tab->editor && tab->editor->document()->isModified();
+}
+
+// The name of the file on the tab and, for the current tab, in the title of the window.
+void showFileName(Tab *tab){
+	QString name = QFileInfo(fileNameOf(tab)).fileName();
+	QTabWidget *tabWidget = tab->window->tabs;
+	tabWidget->setTabText(tabWidget->indexOf(tab->stack), name.isEmpty() ? "Untitled" : name);
+	tabWidget->setTabToolTip(tabWidget->indexOf(tab->stack), fileNameOf(tab));
+	if(isCurrent(tab)) tab->window->main->setWindowTitle(name.isEmpty() ? "Mousepad" : name + " - Mousepad");
+}
+
+void showLineEndings(Tab *tab, LineEndings::Style style, bool mixed){
+	if(!isCurrent(tab)) return;
+	for(QAction *action : tab->window->lineEndingGroup->actions())
+		action->setChecked(action->data().toInt() == style);
+	if(mixed) tab->window->main->statusBar()->showMessage("The file has mixed line endings; it will be saved with " + LineEndings::name(style));
+}
+
+void setLineEndingStyle(Tab *tab, LineEndings::Style style){
+	if(showsLargeView(tab)) tab->largeView->setLineEndingStyle(style);
+	else if(tab->editor) tab->editor->setLineEndingStyle(style);
+}
+
+void setEncodingName(Tab *tab, const QString &name){
+	tab->encodingName = name;
+	if(isCurrent(tab)) tab->window->encodingLabel->setText(name);
+}
+
+void stopJournal(Tab *tab){
+	EditJournal *journal = tab->journal;
+	tab->journal = nullptr;
+	if(!journal) return;
+	journal->discard();
+	delete journal;
+}
+
+// Journals the edits of the view shown, whose text is its file or the given checkpoint.
+void startJournal(Tab *tab, const SaveFunction &checkpoint = SaveFunction()){
+	stopJournal(tab);
+	QString fileName = fileNameOf(tab);
+	if(fileName.isEmpty()) return;
+	if(showsLargeView(tab)){
+		LargeFileView *largeView = tab->largeView;
+		tab->journal = new EditJournal(fileName, largeView);
+		QObject::connect(largeView, &LargeFileView::edited, tab->journal, &EditJournal::record);
+		tab->journal->setSnapshotFunction([largeView]{return largeView->snapshot();});
+		// each checkpoint copies the whole file
+		tab->journal->setCheckpointBytes(qMax<qint64>(4 << 20, QFileInfo(fileName).size() / 16));
+	} else {
+		CodeEditor *editor = tab->editor;
+		tab->journal = new EditJournal(fileName, editor);
+		QObject::connect(editor, &CodeEditor::edited, tab->journal, &EditJournal::record);
+		// a checkpoint copies the whole text on this thread, as a save does
+		tab->journal->setSnapshotFunction([editor]{
+			return editor->document()->characterCount() > maxCheckpointChars ? SaveFunction() : editor->snapshot();
+		});
+	}
+	tab->journal->start(checkpoint);
+}
+
+void endJournalSave(const QString &fileName, bool saved){
+	for(Tab *tab : tabs)
+		if(tab->journal && fileNameOf(tab) == fileName) tab->journal->endSave(saved);
+}
+
+// Waits for the saves still being written, so that none is cut off before its rename.
+void finishSaves(){
+	if(!saver->isSaving()) return;
+	QEventLoop loop;
+	QObject::connect(saver, &AsyncSaver::idle, &loop, &QEventLoop::quit);
+	loop.exec(QEventLoop::ExcludeUserInputEvents);
+}
+
+void flushJournals(){
+	for(Tab *tab : tabs)
+		if(tab->journal) tab->journal->flush();
+}
+
+// Puts back the cursor and scroll position the document had in the last session, or before it hibernated.
+void restoreView(Tab *tab){
+	if(tab->restoringView.fileName.isEmpty() || tab->restoringView.fileName != fileNameOf(tab)) return;
+	Session::Document view = tab->restoringView;
+	tab->restoringView = Session::Document();
+	if(showsLargeView(tab)){
+		tab->largeView->setCursorPosition(view.cursorLine, view.cursorColumn);
+		tab->largeView->scrollToLine(view.firstLine);
+	} else {
+		QTextDocument *text = tab->editor->document();
+		QTextBlock block = text->findBlockByNumber(int(qMin<qint64>(view.cursorLine, text->blockCount() - 1)));
+		QTextCursor cursor(block);
+		cursor.setPosition(block.position() + qMin(view.cursorColumn, block.length() - 1));
+		tab->editor->setTextCursor(cursor);
+		tab->editor->verticalScrollBar()->setValue(int(view.firstLine));
+	}
+}
+
+// Where a document is shown, as a session keeps it.
+Session::Document viewOf(Tab *tab){
+	// not read yet, or still loading: the view was not put back yet
+	if(!tab->placeholder.fileName.isEmpty()) return tab->placeholder;
+	if(!tab->restoringView.fileName.isEmpty() && tab->restoringView.fileName == fileNameOf(tab)) return tab->restoringView;
+	Session::Document view;
+	if(showsLargeView(tab)){
+		LargeFileView *largeView = tab->largeView;
+		view.fileName = largeView->fileName();
+		view.cursorLine = largeView->cursorLineNumber();
+		view.cursorColumn = largeView->cursorColumnNumber();
+		view.firstLine = largeView->firstVisibleLine();
+		view.encoding = largeView->textEncoding();
+		view.lineEndings = largeView->lineEndingStyle();
+	} else if(tab->editor){
+		CodeEditor *editor = tab->editor;
+		QTextCursor cursor = editor->textCursor();
+		view.fileName = editor->fileName();
+		view.cursorLine = cursor.blockNumber();
+		view.cursorColumn = cursor.positionInBlock();
+		view.firstLine = editor->cursorForPosition(QPoint(0, 0)).blockNumber();
+		view.encoding = editor->textEncoding();
+		view.lineEndings = editor->lineEndingStyle();
+		view.compression = editor->compressionFormat();
+	}
+	return view;
+}
+
+// The documents of all windows and where they are shown, for the next start; a session that was not put back is kept for it.
+void saveSession(){
+	if(!settings->value("RestoreSession", true).toBool() || !sessionRestored) return;
+	Session session;
+	for(Window *w : windows){
+		for(int i = 0; i < w->tabs->count(); ++i){
+			Tab *tab = tabs.value(w->tabs->widget(i));
+			Session::Document view = viewOf(tab);
+			if(view.fileName.isEmpty()) continue;
+			if(w == activeWindow && i == w->tabs->currentIndex()) session.current = session.documents.size();
+			session.documents.append(view);
+		}
+	}
+	if(session.current < 0 && !session.documents.isEmpty()) session.current = 0;
+	if(!session.save()) qWarning("Failed to save the session");
+}
+
+// The line of Go to, once it is there or nothing more is loaded or indexed; the last line is gone to then.
+void goToPendingLine(Tab *tab){
+	if(tab->gotoLine < 0) return;
+	if(showsLargeView(tab)){
+		if(tab->gotoLine >= tab->largeView->lineCount() && !tab->largeView->isIndexed()) return;
+		tab->largeView->goToLine(tab->gotoLine, tab->gotoColumn);
+	} else {
+		if(tab->gotoLine >= tab->editor->blockCount() && tab->loader) return;
+		tab->editor->goToLine(int(qMin<qint64>(tab->gotoLine, INT_MAX)), tab->gotoColumn);
+	}
+	tab->gotoLine = -1;
+}
+
+// Starts the edit trace over on the document of a tab, if it is read and the one being worked on.
+void recordTab(Tab *tab){
+	if(!recorder || tab->window != activeWindow || !isCurrent(tab) || showsLargeView(tab) || !tab->editor || tab->loader) return;
+	recorder->start(tab->editor);
+}
+
+void save(Tab *tab);
+
+// Replays the journal being recovered, if any, then journals the document.
+void documentLoaded(Tab *tab){
+	// the trace starts from the file as read; recovered edits are part of it
+	recordTab(tab);
+	restoreView(tab);
+	goToPendingLine(tab);
+	if(tab->pendingRecovery.key.isEmpty()){
+		startJournal(tab);
+		return;
+	}
+	EditJournal::Orphan orphan = tab->pendingRecovery;
+	tab->pendingRecovery = EditJournal::Orphan();
+	// changes read back from hibernation are no news
+	bool woken = orphan.key == tab->hibernatedChanges.key;
+	tab->hibernatedChanges = EditJournal::Orphan();
+	bool complete;
+	if(showsLargeView(tab)){
+		LargeFileView *largeView = tab->largeView;
+		complete = EditJournal::replay(orphan, [largeView](qint64 position, qint64 removed, const QByteArray &inserted){largeView->applyEdit(position, removed, inserted);});
+	} else {
+		CodeEditor *editor = tab->editor;
+		complete = EditJournal::replay(orphan, [editor](qint64 position, qint64 removed, const QByteArray &inserted){editor->applyEdit(position, removed, inserted);});
+	}
+	// a checkpoint alone has no edits to replay that would mark it
+	if(woken && !showsLargeView(tab)) tab->editor->document()->setModified(true);
+	if(!woken || !complete) tab->window->main->statusBar()->showMessage(complete ? "Recovered the unsaved changes" : "Recovered part of the unsaved changes; the journal is damaged");
+	EditJournal::discard(orphan);
+	// the recovered text is not on disk, so the new journal starts from a checkpoint
+	startJournal(tab, showsLargeView(tab) ? tab->largeView->snapshot() : tab->editor->snapshot());
+	if(tab->saveWhenLoaded){
+		tab->saveWhenLoaded = false;
+		save(tab);
+	}
+}
+
+void showLoadProgress(Window *w, bool visible){
+	w->loadLabel->setVisible(visible);
+	w->loadProgress->setVisible(visible);
+	w->loadCancelButton->setVisible(visible);
+}
+
+void endLoad(Tab *tab, const QString &message){
+	if(isCurrent(tab)) showLoadProgress(tab->window, false);
+	tab->editor->document()->setUndoRedoEnabled(true);
+	if(!message.isEmpty()) tab->window->main->statusBar()->showMessage(message);
+	tab->loader->deleteLater();
+	tab->loader = nullptr;
+}
+
+void appendChunk(Tab *tab, const QString &text, qint64 bytesRead, qint64 totalBytes){
+	TraceSpan span("load", "appendChunk");
+	span.arg("chars", text.size());
+	QTextCursor cursor(tab->editor->document());
+	cursor.movePosition(QTextCursor::End);
+	cursor.insertText(text);
+
+	if(isCurrent(tab)){
+		Window *w = tab->window;
+		QLocale locale;
+		if(totalBytes > 0){
+			w->loadLabel->setText(locale.formattedDataSize(bytesRead) + " / " + locale.formattedDataSize(totalBytes));
+			w->loadProgress->setMaximum(1000);
+			w->loadProgress->setValue(int(bytesRead * 1000 / totalBytes));
+		} else {
+			// decompressing: the size is not known yet
+			w->loadLabel->setText(locale.formattedDataSize(bytesRead));
+			w->loadProgress->setMaximum(0);
+		}
+	}
+	goToPendingLine(tab);
+	tab->loader->chunkDone();
+}
+
+void setFollowing(Tab *tab, bool follow);
+
+// Reads the file into the editor from a worker thread, chunk by chunk.
+void startLoad(Tab *tab, const QString &fileName){
+	CodeEditor *editor = tab->editor;
+	tab->loader = new FileLoader(tab->stack);
+	FileLoader *loader = tab->loader;
+	QObject::connect(loader, &FileLoader::encodingDetected, loader, [tab](const QString &name){setEncodingName(tab, name);});
+	QObject::connect(loader, &FileLoader::invalidSequence, loader, [tab](qint64 offset){
+		tab->window->main->statusBar()->showMessage("Invalid UTF-8 at byte " + QString::number(offset) + "; such bytes are shown as boxes and saved as they were");
+	});
+	QObject::connect(loader, &FileLoader::chunkRead, loader, [tab](const QString &text, qint64 bytesRead, qint64 totalBytes){appendChunk(tab, text, bytesRead, totalBytes);});
+	QObject::connect(loader, &FileLoader::loaded, loader, [tab, editor, loader]{
+		const LineEndings &endings = loader->lineEndings();
+		editor->setFileFormat(loader->textEncoding(), loader->hasBom(), endings.dominant());
+		tab->compression = loader->compression();
+		editor->setCompression(tab->compression);
+		if(isCurrent(tab)){
+			tab->window->compressAction->setEnabled(tab->compression != Compression::None);
+			tab->window->compressAction->setChecked(tab->compression != Compression::None);
+		}
+		if(tab->compression != Compression::None) setEncodingName(tab, tab->encodingName + ", " + Compression::name(tab->compression));
+		editor->setReadOnly(false);
+		editor->document()->setModified(false);
+		tab->fileSize = loader->bytesRead();
+		endLoad(tab, QString());
+		showLineEndings(tab, editor->lineEndingStyle(), endings.isMixed());
+		tab->reloader->watch();
+		documentLoaded(tab);
+		if(tab->resumeFollowing) setFollowing(tab, true);
+		tab->resumeFollowing = false;
+	});
+	QObject::connect(loader, &FileLoader::canceled, loader, [tab]{
+		endLoad(tab, "Loading canceled; the part read so far is shown read-only");
+		goToPendingLine(tab);
+	});
+	QObject::connect(loader, &FileLoader::failed, loader, [tab, loader](const QString &error){
+		endLoad(tab, "Failed to read " + loader->fileName() + ": " + error);
+		goToPendingLine(tab);
+	});
+
+	editor->setReadOnly(true); // until the whole file is there
+	editor->document()->setUndoRedoEnabled(false);
+	editor->clear();
+	if(isCurrent(tab)){
+		Window *w = tab->window;
+		w->loadProgress->setMaximum(1000);
+		w->loadProgress->setValue(0);
+		w->loadLabel->clear();
+		w->compressAction->setEnabled(false);
+		showLoadProgress(w, true);
+		w->main->statusBar()->clearMessage();
+	}
+	loader->load(fileName);
+}
+
+void cancelLoad(Tab *tab){
+	if(!tab->loader) return;
+	/* drops the chunks still queued for the editor */
+	delete tab->loader;
+	tab->loader = nullptr;
+	if(isCurrent(tab)) showLoadProgress(tab->window, false);
+	tab->editor->document()->setUndoRedoEnabled(true);
+}
+
+// LargeFileView indexes lines by their '\n' or '\r' bytes, which UTF-16 breaks.
+bool isUtf16(const QString &fileName){
+	QFile file(fileName);
+	if(!file.open(QIODevice::ReadOnly)) return false;
+	QByteArray start = file.read(4096);
+	TextEncoding::Encoding encoding = TextEncoding::detect(start.constData(), start.size()).encoding;
+	return encoding == TextEncoding::Utf16LE || encoding == TextEncoding::Utf16BE;
+}
+
+// Appends what was written to the followed file, scrolling along if the view was at the bottom.
+void appendFollowed(Tab *tab, const QString &text){
+	TraceSpan span("load", "appendFollowed");
+	span.arg("chars", text.size());
+	CodeEditor *editor = tab->editor;
+	QScrollBar *bar = editor->verticalScrollBar();
+	bool atBottom = bar->value() == bar->maximum();
+	QTextCursor cursor(editor->document());
+	cursor.movePosition(QTextCursor::End);
+	cursor.insertText(text);
+	editor->document()->setModified(false);
+	if(atBottom) bar->setValue(bar->maximum());
+}
+
+bool openFile(Tab *tab, const QString &fileName, const EditJournal::Orphan &recovery = EditJournal::Orphan());
+
+void initFollower(Tab *tab){
+	tab->follower = new LogFollower(tab->stack);
+	QObject::connect(tab->follower, &LogFollower::appended, [tab](const QString &text){appendFollowed(tab, text);});
+	QObject::connect(tab->follower, &LogFollower::truncated, [tab]{
+		QString fileName = tab->follower->fileName();
+		setFollowing(tab, false);
+		if(!openFile(tab, fileName)) return;
+		tab->resumeFollowing = true;
+		tab->window->main->statusBar()->showMessage("The file was truncated or replaced; it is read again");
+	});
+}
+
+void showFollowing(Tab *tab){
+	if(!isCurrent(tab)) return;
+	QSignalBlocker blocker(tab->window->followAction);
+	tab->window->followAction->setChecked(tab->follower && tab->follower->isFollowing());
+}
+
+// The editor is read-only while it follows its file.
+void setFollowing(Tab *tab, bool follow){
+	CodeEditor *editor = tab->editor;
+	if(!follow){
+		if(tab->follower && tab->follower->isFollowing()){
+			// following again goes on from there, not from where the file was loaded
+			tab->fileSize = tab->follower->shownBytes();
+			tab->follower->stop();
+			editor->setReadOnly(false);
+			editor->document()->setUndoRedoEnabled(true);
+			tab->reloader->watch();
+			startJournal(tab);
+		}
+		showFollowing(tab);
+		return;
+	}
+	if(tab->follower && tab->follower->isFollowing()) return;
+	if(!editor || showsLargeView(tab) || tab->loader || editor->isReadOnly() || editor->fileName().isEmpty() || editor->document()->isModified() || tab->compression != Compression::None){
+		tab->window->main->statusBar()->showMessage("Only an unmodified, uncompressed file that is loaded in the editor can be followed");
+		showFollowing(tab);
+		return;
+	}
+	if(!tab->follower) initFollower(tab);
+	stopJournal(tab);
+	tab->reloader->unwatch();
+	editor->setReadOnly(true);
+	editor->document()->setUndoRedoEnabled(false);
+	if(Highlighter::languageForFile(editor->fileName()).isEmpty()) editor->setLanguage("log");
+	QScrollBar *bar = editor->verticalScrollBar();
+	bar->setValue(bar->maximum());
+	if(!tab->follower->follow(editor->fileName(), tab->fileSize, editor->textEncoding()))
+		tab->window->main->statusBar()->showMessage("Failed to follow " + editor->fileName());
+	showFollowing(tab);
+}
+
+void initReloader(Tab *tab){
+	tab->reloader = new FileReloader(tab->editor, tab->editor);
+	FileReloader *reloader = tab->reloader;
+	QObject::connect(reloader, &FileReloader::changed, [tab, reloader](const QString &fileName){
+		if(savingFiles.contains(fileName)) return; // our own save; watched again once it is done
+		if(tab->editor->document()->isModified()){
+			QMessageBox::StandardButton answer = QMessageBox::question(tab->window->main, "Reload",
+				fileName + " was changed by another program. Reload it? Your changes can be brought back with Undo.");
+			if(answer != QMessageBox::Yes){
+				reloader->watch(); // not asked again for this version
+				return;
+			}
+		}
+		reloader->reload();
+	});
+	QObject::connect(reloader, &FileReloader::reloaded, [tab, reloader](int hunks){
+		tab->fileSize = reloader->fileSize();
+		// the journal starts over from the new file
+		startJournal(tab);
+		tab->window->main->statusBar()->showMessage("Reloaded " + tab->editor->fileName() + ": " + QString::number(hunks) + " changed places", 3000);
+	});
+	QObject::connect(reloader, &FileReloader::failed, [tab](const QString &error){
+		tab->window->main->statusBar()->showMessage("Failed to reload " + tab->editor->fileName() + ": " + error);
+	});
+}
+
+// The editor of a tab is only created once a file is read into it, so that tabs not shown yet cost little.
+void ensureEditor(Tab *tab){
+	if(tab->editor) return;
+	tab->editorPane = new QSplitter(Qt::Vertical, tab->stack);
+	tab->editor = new CodeEditor(editorFont, tab->editorPane);
+	tab->editorPane->addWidget(tab->editor);
+	tab->stack->addWidget(tab->editorPane);
+	if(lineNumbersDisabled) tab->editor->disableLineNumbers(true);
+	initReloader(tab);
+}
+
+void ensureLargeView(Tab *tab){
+	if(tab->largeView) return;
+	tab->largeView = new LargeFileView(editorFont, tab->stack);
+	tab->stack->addWidget(tab->largeView);
+	QObject::connect(tab->largeView, &LargeFileView::indexingProgress, [tab](qint64 scanned, qint64 total){
+		if(!showsLargeView(tab)) return;
+		goToPendingLine(tab);
+		if(scanned != total) return;
+		showLineEndings(tab, tab->largeView->lineEndingStyle(), tab->largeView->lineEndings().isMixed());
+		documentLoaded(tab);
+	});
+}
+
+void showSplit(Tab *tab){
+	if(!isCurrent(tab)) return;
+	QSignalBlocker blocker(tab->window->splitAction);
+	tab->window->splitAction->setChecked(tab->splitView != nullptr);
+	tab->window->splitAction->setEnabled(!showsLargeView(tab));
+}
+
+// A second view of the document below the first, sharing its text, layout and highlighting.
+void setSplit(Tab *tab, bool split){
+	if(split && !tab->splitView && tab->editor && !showsLargeView(tab)){
+		tab->splitView = new CodeEditor(tab->editor, tab->editorPane);
+		tab->editorPane->addWidget(tab->splitView);
+		if(lineNumbersDisabled) tab->splitView->disableLineNumbers(true);
+		// starts where the first view is
+		tab->splitView->setTextCursor(tab->editor->textCursor());
+		tab->splitView->centerCursor();
+	} else if(!split && tab->splitView){
+		delete tab->splitView;
+		tab->splitView = nullptr;
+	}
+	showSplit(tab);
+}
+
+// A recovered journal is replayed into the file once it is loaded, under the name of its own file.
+bool openFile(Tab *tab, const QString &fileName, const EditJournal::Orphan &recovery){
+	QFileInfo info(fileName);
+	if(!info.isFile() || !info.isReadable()) return false;
+	QString name = recovery.key.isEmpty() ? fileName : recovery.fileName;
+	QString lang = Highlighter::languageForFile(name);
+	// compressed files are decompressed into the editor
+	bool large = info.size() >= largeFileSize && Compression::detectFile(fileName) == Compression::None;
+	if(large && isUtf16(fileName)){
+		QMessageBox::StandardButton answer = QMessageBox::question(tab->window->main, "Open",
+			name + " is a UTF-16 file of " + QLocale().formattedDataSize(info.size()) + ", which can only be read into memory as a whole. Open it anyway?");
+		if(answer != QMessageBox::Yes) return false;
+		large = false;
+	}
+	ensureEditor(tab);
+	cancelLoad(tab);
+	tab->placeholder = Session::Document();
+	tab->reloader->unwatch();
+	if(tab->follower) tab->follower->stop();
+	tab->resumeFollowing = false;
+	tab->gotoLine = -1;
+	if(large){
+		ensureLargeView(tab);
+		if(!tab->largeView->openFile(fileName)) return false;
+		stopJournal(tab);
+		tab->pendingRecovery = recovery;
+		tab->largeView->setFileName(name);
+		tab->largeView->setLanguage(lang);
+		tab->stack->setCurrentWidget(tab->largeView);
+		setEncodingName(tab, TextEncoding::name(tab->largeView->textEncoding()));
+		if(tab->largeView->isIndexed()){
+			showLineEndings(tab, tab->largeView->lineEndingStyle(), tab->largeView->lineEndings().isMixed());
+			documentLoaded(tab);
+		}
+	} else {
+		stopJournal(tab);
+		tab->pendingRecovery = recovery;
+		tab->editor->setLanguage(lang);
+		tab->editor->setFileName(name);
+		tab->stack->setCurrentWidget(tab->editorPane);
+		tab->compression = Compression::None;
+		startLoad(tab, fileName);
+	}
+	showFollowing(tab);
+	showSplit(tab);
+	showFileName(tab);
+	return true;
+}
+
+// Reads a tab that was not read yet or hibernated, and puts its view back, with its unsaved changes.
+void openPlaceholder(Tab *tab){
+	Session::Document view = tab->placeholder;
+	if(view.fileName.isEmpty()) return;
+	tab->restoringView = view;
+	EditJournal::Orphan changes = tab->hibernatedChanges;
+	if(openFile(tab, changes.key.isEmpty() ? view.fileName : changes.base, changes)) return;
+	tab->restoringView = Session::Document();
+	tab->window->main->statusBar()->showMessage("Failed to read " + view.fileName);
+}
+
+// Stops counting the matches of the find bar, and lets go of the snapshot they were counted in.
+void clearSearch(Window *w){
+	w->matchCounter->cancel();
+	w->searchSnapshot = LineSnapshot();
+	w->searchSnapshotView = nullptr;
+	w->matchLabel->clear();
+}
+
+// Shows the state of the current tab of a window in its title, menus and status bar.
+void showTab(Window *w){
+	Tab *tab = currentTab(w);
+	if(!tab) return;
+	openPlaceholder(tab);
+	showFileName(tab);
+	w->encodingLabel->setText(tab->encodingName);
+	showLoadProgress(w, tab->loader != nullptr);
+	LineEndings::Style style = showsLargeView(tab) ? tab->largeView->lineEndingStyle() : tab->editor ? tab->editor->lineEndingStyle() : LineEndings::Lf;
+	for(QAction *action : w->lineEndingGroup->actions())
+		action->setChecked(action->data().toInt() == style);
+	{
+		QSignalBlocker blocker(w->compressAction);
+		w->compressAction->setEnabled(!showsLargeView(tab) && tab->compression != Compression::None);
+		w->compressAction->setChecked(tab->editor && tab->editor->compressionFormat() != Compression::None);
+	}
+	showFollowing(tab);
+	showSplit(tab);
+	if(w->findToolBar) clearSearch(w);
+	if(recorder && recorder->recordedEditor() != tab->editor) recordTab(tab);
+	if(w == activeWindow && QGuiApplication::applicationState() == Qt::ApplicationActive) hibernator->setCurrent(tab->stack);
+}
+
+// An empty, untitled tab, made current.
+Tab *newTab(Window *w){
+	Tab *tab = new Tab();
+	tab->window = w;
+	tab->compression = Compression::None;
+	tab->gotoLine = -1;
+	tab->stack = new QStackedWidget(w->tabs);
+	tabs.insert(tab->stack, tab);
+	ensureEditor(tab);
+	tab->stack->setCurrentWidget(tab->editorPane);
+	w->tabs->setCurrentIndex(w->tabs->addTab(tab->stack, "Untitled"));
+	return tab;
+}
+
+// A tab of a session or a hibernated one: only its page, until it is shown.
+Tab *newPlaceholderTab(Window *w, const Session::Document &view){
+	Tab *tab = new Tab();
+	tab->window = w;
+	tab->compression = Compression::None;
+	tab->gotoLine = -1;
+	tab->placeholder = view;
+	tab->stack = new QStackedWidget(w->tabs);
+	tabs.insert(tab->stack, tab);
+	int index = w->tabs->addTab(tab->stack, QFileInfo(view.fileName).fileName());
+	w->tabs->setTabToolTip(index, view.fileName);
+	return tab;
+}
+
+// Asks before unsaved changes are dropped; returns false if the tab stays open.
+bool confirmClose(Tab *tab){
+	if(!isModified(tab)) return true;
+	tab->window->tabs->setCurrentWidget(tab->stack);
+	QMessageBox::StandardButton answer = QMessageBox::question(tab->window->main, "Close",
+		fileNameOf(tab) + " has unsaved changes. Close it without saving?");
+	return answer == QMessageBox::Yes;
+}
+
+void dropTab(Tab *tab){
+	if(tab->editor) cancelLoad(tab);
+	stopJournal(tab);
+	if(!tab->hibernatedChanges.key.isEmpty()) EditJournal::discard(tab->hibernatedChanges);
+	hibernator->remove(tab->stack);
+	tabs.remove(tab->stack);
+	tab->window->tabs->removeTab(tab->window->tabs->indexOf(tab->stack));
+	delete tab->stack;
+	delete tab;
+}
+
+// The window goes with its last tab; closing a window asks about its tabs itself.
+void closeTab(Tab *tab){
+	Window *w = tab->window;
+	if(w->tabs->count() == 1 && windows.size() > 1){
+		w->main->close();
+		return;
+	}
+	if(!confirmClose(tab)) return;
+	if(w->tabs->count() == 1){
+		w->main->close();
+		return;
+	}
+	dropTab(tab);
+}
+
+// A tab to open a file in: the tab of the file if it is open, the current one if it is empty, or a new one.
+Tab *tabForFile(Window *w, const QString &fileName){
+	QString path = QFileInfo(fileName).absoluteFilePath();
+	for(Tab *tab : tabs){
+		if(!fileNameOf(tab).isEmpty() && QFileInfo(fileNameOf(tab)).absoluteFilePath() == path) return tab;
+	}
+	Tab *tab = currentTab(w);
+	if(tab && fileNameOf(tab).isEmpty() && !isModified(tab) && !tab->loader) return tab;
+	return newTab(w);
+}
+
+// Opens a file in its own tab, or shows the tab it is already open in.
+bool openFileInTab(Window *w, const QString &fileName){
+	Tab *tab = tabForFile(w, fileName);
+	if(!fileNameOf(tab).isEmpty()){
+		tab->window->tabs->setCurrentWidget(tab->stack);
+		tab->window->main->activateWindow();
+		return true;
+	}
+	if(openFile(tab, fileName)) return true;
+	// a tab made for the file is not kept
+	if(w->tabs->count() > 1 && fileNameOf(tab).isEmpty() && !isModified(tab)) dropTab(tab);
+	return false;
+}
+
+// Offers to recover each journal left behind, by a quit with unsaved changes or a crash.
+void recoverJournal(Window *w){
+	QVector<EditJournal::Orphan> orphans = EditJournal::orphans();
+	for(const EditJournal::Orphan &orphan : orphans){
+		QMessageBox::StandardButton answer = QMessageBox::question(w->main, "Recover",
+			"Unsaved changes to " + orphan.fileName + " were kept from the last session. Recover them?");
+		if(answer != QMessageBox::Yes){
+			EditJournal::discard(orphan);
+			continue;
+		}
+		// in the empty tab if there is one, else in its own
+		Tab *tab = currentTab(w);
+		bool made = !fileNameOf(tab).isEmpty() || isModified(tab) || tab->loader;
+		if(made) tab = newTab(w);
+		// the tab of the session showing the file as it is saved gives way
+		Tab *saved = nullptr;
+		QString path = QFileInfo(orphan.fileName).absoluteFilePath();
+		for(Tab *other : tabs){
+			if(other != tab && !isModified(other) && !fileNameOf(other).isEmpty() && QFileInfo(fileNameOf(other)).absoluteFilePath() == path) saved = other;
+		}
+		if(openFile(tab, orphan.base, orphan)){
+			if(saved) dropTab(saved);
+			continue;
+		}
+		if(made) dropTab(tab);
+		QErrorMessage *msg = new QErrorMessage(w->main);
+		msg->setAttribute(Qt::WA_DeleteOnClose);
+		msg->showMessage("Failed to open " + orphan.base + "; the journal is kept in " + EditJournal::directory());
+	}
+}
+
+// Puts back the tabs of the last session; only the current one is read, the others once they are shown.
+void restoreSession(Window *w){
+	if(!settings->value("RestoreSession", true).toBool()) return;
+	Session session = Session::load();
+	sessionRestored = true;
+	if(session.current < 0) return;
+	Tab *empty = currentTab(w);
+	Tab *current = nullptr;
+	for(int i = 0; i < session.documents.size(); ++i){
+		Tab *tab = newPlaceholderTab(w, session.documents.at(i));
+		if(i == session.current) current = tab;
+	}
+	w->tabs->setCurrentWidget(current->stack);
+	dropTab(empty);
+}
+
+// Drops the editor of a tab, keeping where it was shown; unsaved changes are kept in a checkpoint of its journal.
+void hibernateTab(Tab *tab){
+	// the current tabs of the other windows are still in sight
+	if(isCurrent(tab) || !tab->placeholder.fileName.isEmpty() || tab->loader || (tab->follower && tab->follower->isFollowing())) return;
+	QString fileName = fileNameOf(tab);
+	if(fileName.isEmpty()) return;
+	bool modified = isModified(tab);
+	// a large file would be copied whole for the checkpoint, and a large document on this thread
+	if(modified && (showsLargeView(tab) || !tab->journal || tab->editor->document()->characterCount() > maxCheckpointChars)) return;
+	if(!modified && !QFileInfo(fileName).isFile()) return;
+	TraceSpan span("memory", "hibernateTab");
+	span.arg("bytes", (tab->editor ? tab->editor->memoryUsage() : 0) + (tab->largeView ? tab->largeView->memoryUsage() : 0));
+	Session::Document view = viewOf(tab);
+	if(modified){
+		// waits for the checkpoint to be on disk; the journal stays, locked, until the changes are read back
+		EditJournal::Orphan changes = tab->journal->suspend(tab->editor->snapshot());
+		if(changes.key.isEmpty()) return;
+		tab->journal->setParent(tab->stack);
+		tab->hibernatedChanges = changes;
+	} else stopJournal(tab);
+	// also drops the undo history, and the reloader and split view with the editor
+	delete tab->editorPane;
+	tab->editorPane = nullptr;
+	tab->editor = nullptr;
+	tab->splitView = nullptr;
+	tab->reloader = nullptr;
+	delete tab->largeView;
+	tab->largeView = nullptr;
+	tab->placeholder = view;
+}
+
+void initHibernator(Hibernator *hibernator){
+	hibernator->setTimeout(settings->value("HibernateAfter", 600).toInt());
+	QObject::connect(hibernator, &Hibernator::hibernate, [](QWidget *document){
+		if(tabs.contains(document)) hibernateTab(tabs.value(document));
+	});
+	QObject::connect(hibernator, &Hibernator::wake, [](QWidget *document){
+		if(tabs.contains(document)) openPlaceholder(tabs.value(document));
+	});
+	// the application in the background leaves all its documents idle
+	QObject::connect(qApp, &QGuiApplication::applicationStateChanged, [](Qt::ApplicationState state){
+		Tab *tab = activeWindow ? currentTab(activeWindow) : nullptr;
+		hibernator->setCurrent(state == Qt::ApplicationActive && tab ? tab->stack : nullptr);
+	});
+}
+
+// Estimated memory of each document, to see what hibernation gives back.
+void showMemoryUsage(Window *w){
+	QLocale locale;
+	QString report;
+	for(Window *window : windows){
+		for(int i = 0; i < window->tabs->count(); ++i){
+			Tab *tab = tabs.value(window->tabs->widget(i));
+			QString fileName = fileNameOf(tab);
+			if(fileName.isEmpty()) continue;
+			qint64 bytes = (tab->editor ? tab->editor->memoryUsage() : 0) + (tab->largeView ? tab->largeView->memoryUsage() : 0);
+			report += QFileInfo(fileName).fileName() + ": " + locale.formattedDataSize(bytes);
+			if(!tab->placeholder.fileName.isEmpty()) report += hibernator->isHibernating(tab->stack) ? " (hibernating)" : " (not read yet)";
+			report += "\n";
+		}
+	}
+	if(report.isEmpty()) report = "No documents are open.";
+	QMessageBox::information(w->main, "Memory Usage", report.trimmed());
+}
+
+// Adds a snapshot of the view shown in a tab to a batch.
+bool snapshotDocument(Tab *tab, QVector<SaveJob> &jobs){
+	SaveJob job;
+	QStatusBar *bar = tab->window->main->statusBar();
+	if(showsLargeView(tab)){
+		job.fileName = tab->largeView->fileName();
+		job.write = tab->largeView->snapshot();
+		if(!job.write){
+			bar->showMessage("The file can be saved once it is indexed");
+			return false;
+		}
+		job.revision = tab->largeView->revision();
+	} else {
+		if(tab->loader || tab->editor->isReadOnly()){
+			bar->showMessage("The file is not completely loaded; saving it would truncate it");
+			return false;
+		}
+		job.fileName = tab->editor->fileName();
+		job.write = tab->editor->snapshot();
+		job.revision = tab->editor->revision();
+	}
+	++savingFiles[job.fileName];
+	if(tab->journal) tab->journal->beginSave(job.fileName);
+	else startJournal(tab, job.write); // a file that had no name
+	jobs.append(job);
+	return true;
+}
+
+void saveAs(Tab *tab){
+	// not read yet, so nothing to save
+	if(!tab->placeholder.fileName.isEmpty()) return;
+	QString fileName = QFileDialog::getSaveFileName(tab->window->main, "Save As", fileNameOf(tab));
+	if(fileName.isEmpty()) return;
+	if(showsLargeView(tab)) tab->largeView->setFileName(fileName);
+	else tab->editor->setFileName(fileName);
+	showFileName(tab);
+
+	QVector<SaveJob> jobs;
+	if(snapshotDocument(tab, jobs)) saver->save(jobs);
+}
+
+void save(Tab *tab){
+	if(!tab->placeholder.fileName.isEmpty()) return;
+	if(fileNameOf(tab).isEmpty()){
+		saveAs(tab);
+		return;
+	}
+	QVector<SaveJob> jobs;
+	if(snapshotDocument(tab, jobs)) saver->save(jobs);
+}
+
+// One batch for the tabs of all windows, so that the files are synced to disk together.
+void saveAll(){
+	QVector<SaveJob> jobs;
+	for(Tab *tab : tabs){
+		if(!tab->hibernatedChanges.key.isEmpty()){
+			// read back first, and saved once loaded
+			tab->saveWhenLoaded = true;
+			openPlaceholder(tab);
+			continue;
+		}
+		if(!fileNameOf(tab).isEmpty() && tab->placeholder.fileName.isEmpty() && isModified(tab)) snapshotDocument(tab, jobs);
+	}
+	saver->save(jobs);
+}
+
+// A save of a file is done; its later saves, if any, still are not.
+void endSave(const QString &fileName){
+	if(--savingFiles[fileName] <= 0) savingFiles.remove(fileName);
+}
+
+void initSaver(AsyncSaver *saver){
+	QObject::connect(saver, &AsyncSaver::saved, [](const QString &fileName, int revision){
+		endSave(fileName);
+		for(Tab *tab : tabs){
+			if(!tab->placeholder.fileName.isEmpty() || fileNameOf(tab) != fileName) continue;
+			if(showsLargeView(tab)){
+				tab->largeView->markSaved(revision);
+				continue;
+			}
+			tab->editor->markSaved(revision);
+			tab->fileSize = QFileInfo(fileName).size();
+			if(!tab->follower || !tab->follower->isFollowing()) tab->reloader->watch();
+		}
+		endJournalSave(fileName, true);
+		if(activeWindow) activeWindow->main->statusBar()->showMessage("Saved " + fileName, 3000);
+	});
+	QObject::connect(saver, &AsyncSaver::failed, [](const QString &fileName, int, const QString &error){
+		endSave(fileName);
+		endJournalSave(fileName, false);
+		QErrorMessage *msg = new QErrorMessage(activeWindow ? activeWindow->main : nullptr);
+		msg->setAttribute(Qt::WA_DeleteOnClose);
+		msg->showMessage("Failed to save " + fileName + ": " + error);
+	});
+}
+
+void showOpenError(Window *w, const QString &fileName){
+	QErrorMessage *msg = new QErrorMessage(w->main);
+	msg->setAttribute(Qt::WA_DeleteOnClose);
+	msg->showMessage("Failed to open " + fileName);
+}
+
+// Files from a later launch, each in its own tab of the active window.
+void initInstanceServer(InstanceServer *server){
+	QObject::connect(server, &InstanceServer::openRequested, [](const QStringList &fileNames){
+		Window *w = activeWindow;
+		w->main->setWindowState(w->main->windowState() & ~Qt::WindowMinimized);
+		w->main->raise();
+		w->main->activateWindow();
+		for(const QString &fileName : fileNames){
+			if(!openFileInTab(w, fileName)) showOpenError(w, fileName);
+		}
+	});
+}
+
+void openFileDialog(Window *w){
+	QStringList fileNames = QFileDialog::getOpenFileNames(w->main, "Open File");
+	for(const QString &fileName : fileNames){
+		if(!openFileInTab(w, fileName)) showOpenError(w, fileName);
+	}
+}
+
+// Closes the tabs of a window, asking about unsaved changes first; returns false if the window stays open.
+bool closeWindow(Window *w){
+	for(int i = 0; i < w->tabs->count(); ++i){
+		if(!confirmClose(tabs.value(w->tabs->widget(i)))) return false;
+	}
+	// the tabs left are not shown on the way
+	QSignalBlocker blocker(w->tabs);
+	while(w->tabs->count() > 0) dropTab(tabs.value(w->tabs->widget(0)));
+	// a count still going on would report to the window
+	if(w->findToolBar) w->matchCounter->cancel();
+	// the dialogs built in it go with it
+	if(prefswin && prefswin->parentWidget() == w->main) prefswin = nullptr;
+	if(findnReplaceWindow && findnReplaceWindow->parentWidget() == w->main) findnReplaceWindow = nullptr;
+	if(gotoWindow && gotoWindow->parentWidget() == w->main) gotoWindow = nullptr;
+	if(fontWindow && fontWindow->parentWidget() == w->main) fontWindow = nullptr;
+	windows.removeOne(w);
+	if(activeWindow == w) activeWindow = windows.last();
+	w->main->deleteLater();
+	delete w;
+	return true;
+}
+
+// Tracks the active window; closing the last one quits, keeping unsaved changes in the journals.
+class WindowWatcher : public QObject {
+public:
+	explicit WindowWatcher(Window *w) : QObject(w->main), w(w) {}
+
+	bool eventFilter(QObject *watched, QEvent *event) override {
+		if(event->type() == QEvent::WindowActivate){
+			activeWindow = w;
+			Tab *tab = currentTab(w);
+			if(tab && QGuiApplication::applicationState() == Qt::ApplicationActive) hibernator->setCurrent(tab->stack);
+			if(tab && recorder && recorder->recordedEditor() != tab->editor) recordTab(tab);
+		} else if(event->type() == QEvent::Close && windows.size() > 1){
+			if(!closeWindow(w)){
+				event->ignore();
+				return true;
+			}
+		}
+		return QObject::eventFilter(watched, event);
+	}
+
+private:
+	Window *w;
+};
+
+Window *newWindow();
+
+// Moves the current tab of a window to a new one, keeping its document as it is.
+void detachTab(Window *w){
+	if(w->tabs->count() < 2) return;
+	Tab *tab = currentTab(w);
+	Window *target = newWindow();
+	Tab *empty = currentTab(target);
+	w->tabs->removeTab(w->tabs->indexOf(tab->stack));
+	tab->window = target;
+	int index = target->tabs->addTab(tab->stack, QString());
+	target->tabs->setCurrentIndex(index);
+	dropTab(empty);
+}
 
 void initFontWindow(QFontDialog *fontWin){
-	QObject::connect(fontWin, &QFontDialog::currentFontChanged, editor->document(), &QTextDocument::setDefaultFont);
+	// the documents of all windows share one font
+	QObject::connect(fontWin, &QFontDialog::currentFontChanged, [](QFont font){
+		editorFont = font;
+		for(Tab *tab : tabs){
+			if(tab->editor) tab->editor->document()->setDefaultFont(font);
+			if(tab->largeView) tab->largeView->setFont(font);
+		}
+	});
 	QObject::connect(fontWin, &QFontDialog::fontSelected, [](QFont font){settings->setValue("FontData", font.toString());settings->sync();});
 }
 
+void setLineNumbersDisabled(bool disabled){
+	lineNumbersDisabled = disabled;
+	for(Tab *tab : tabs){
+		if(tab->editor) tab->editor->disableLineNumbers(disabled);
+		if(tab->splitView) tab->splitView->disableLineNumbers(disabled);
+	}
+	for(Window *w : windows){
+		QSignalBlocker blocker(w->lineNumbersAction);
+		w->lineNumbersAction->setChecked(disabled);
+	}
+}
+
+// Goes to a line and column, counted from 0; a line not loaded or indexed yet is gone to once it is.
+void goToLine(Tab *tab, qint64 line, int column){
+	tab->gotoLine = line;
+	tab->gotoColumn = column;
+	goToPendingLine(tab);
+	if(tab->gotoLine >= 0) tab->window->main->statusBar()->showMessage("Line " + QString::number(line + 1) + " is not read yet; it is shown once it is");
+}
+
+// Up to the end of the line chosen, when the editor has it; the large file view clamps the column itself.
+void updateGotoColumnRange(){
+	Tab *tab = currentTab(activeWindow);
+	int columns = INT_MAX;
+	if(tab && tab->editor && !showsLargeView(tab)){
+		QTextBlock block = tab->editor->document()->findBlockByNumber(gotoLineSpinner->value() - 1);
+		if(block.isValid()) columns = block.length();
+	}
+	gotoColumnSpinner->setRange(1, columns);
+}
+
 void initGotoWindow(QDialog *gotoWin){
 	gotoWin->setSizePolicy(QSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed));
 	gotoWin->setWindowTitle("Go");
@@ -49,13 +1168,20 @@ void initGotoWindow(QDialog *gotoWin){
 	contents->setLayout(contentsLayout);
 	replaceLayout->addWidget(contents);
 	
-	QSpinBox *lineSpinner = new QSpinBox(contents);
-	contentsLayout->addRow("Line number (y):", lineSpinner);
+	gotoLineSpinner = new QSpinBox(contents);
+	contentsLayout->addRow("Line number (y):", gotoLineSpinner);
+	QObject::connect(gotoLineSpinner, QOverload<int>::of(&QSpinBox::valueChanged), updateGotoColumnRange);
 	
-	QSpinBox *columnSpinner = new QSpinBox(contents);
-	contentsLayout->addRow("Column (x):", columnSpinner);
+	gotoColumnSpinner = new QSpinBox(contents);
+	contentsLayout->addRow("Column (x):", gotoColumnSpinner);
 	
 	QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, gotoWin);
+	QObject::connect(buttonBox, &QDialogButtonBox::accepted, gotoWin, &QDialog::accept);
+	QObject::connect(buttonBox, &QDialogButtonBox::rejected, gotoWin, &QDialog::reject);
+	QObject::connect(gotoWin, &QDialog::accepted, []{
+		Tab *tab = currentTab(activeWindow);
+		if(tab) goToLine(tab, gotoLineSpinner->value() - 1, gotoColumnSpinner->value() - 1);
+	});
 	replaceLayout->addWidget(buttonBox);
 }
 
@@ -98,24 +1224,142 @@ void initFindnReplaceWindow(QDialog *replaceWin){
 	replaceLayout->addWidget(buttonBox);
 }
 
-void initFindToolBar(QToolBar *toolbar){
+void showFontWindow(){
+	if(!fontWindow){
+		fontWindow = new QFontDialog(editorFont, activeWindow->main);
+		initFontWindow(fontWindow);
+	}
+	fontWindow->setVisible(true);
+}
+
+void showGotoWindow(){
+	if(!gotoWindow){
+		gotoWindow = new QDialog(activeWindow->main);
+		initGotoWindow(gotoWindow);
+	}
+	Tab *tab = currentTab(activeWindow);
+	if(!tab || !tab->placeholder.fileName.isEmpty() || (!tab->editor && !tab->largeView)) return;
+	// the lines there so far; a file still loading or indexing may have any number
+	bool large = showsLargeView(tab);
+	qint64 lines = large ? tab->largeView->lineCount() : tab->editor->blockCount();
+	bool complete = large ? tab->largeView->isIndexed() : !tab->loader;
+	gotoLineSpinner->setRange(1, complete ? int(qMin<qint64>(lines, INT_MAX)) : INT_MAX);
+	qint64 line = large ? tab->largeView->cursorLineNumber() : tab->editor->textCursor().blockNumber();
+	gotoLineSpinner->setValue(int(qMin<qint64>(line + 1, INT_MAX)));
+	updateGotoColumnRange();
+	gotoColumnSpinner->setValue(1);
+	gotoLineSpinner->selectAll();
+	gotoLineSpinner->setFocus();
+	gotoWindow->setVisible(true);
+}
+
+void showFindnReplaceWindow(){
+	if(!findnReplaceWindow){
+		findnReplaceWindow = new QDialog(activeWindow->main);
+		initFindnReplaceWindow(findnReplaceWindow);
+	}
+	findnReplaceWindow->setVisible(true);
+}
+
+// The search of the find bar of a window, as typed or as a regular expression.
+QRegularExpression searchExpression(Window *w){
+	QString pattern = w->searchBar->text();
+	if(!w->regularExpressionCheckbox->isChecked()) pattern = QRegularExpression::escape(pattern);
+	return QRegularExpression(pattern, w->matchCaseCheckbox->isChecked() ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+}
+
+// A snapshot of the view shown in a tab, taken once for all the keystrokes of a search while the document stays the same.
+LineSnapshot searchSnapshot(Tab *tab){
+	Window *w = tab->window;
+	QWidget *view = showsLargeView(tab) ? static_cast<QWidget*>(tab->largeView) : tab->editor;
+	int revision = showsLargeView(tab) ? tab->largeView->revision() : tab->editor->revision();
+	if(!w->searchSnapshot || w->searchSnapshotView != view || w->searchSnapshotRevision != revision){
+		w->searchSnapshot = showsLargeView(tab) ? tab->largeView->lineSnapshot() : tab->editor->lineSnapshot();
+		w->searchSnapshotView = view;
+		w->searchSnapshotRevision = revision;
+	}
+	return w->searchSnapshot;
+}
+
+// Moves to a match of the search in the current tab at once, and counts all of them in the background.
+void findMatch(Window *w, MatchCounter::Jump jump){
+	Tab *tab = currentTab(w);
+	QRegularExpression expression = searchExpression(w);
+	// the count of the previous keystroke is of no use any more
+	w->matchCounter->cancel();
+	if(!tab || !tab->placeholder.fileName.isEmpty() || w->searchBar->text().isEmpty()){
+		w->matchLabel->clear();
+		return;
+	}
+	if(!expression.isValid()){
+		w->matchLabel->setText("Invalid expression");
+		return;
+	}
+	LineSnapshot lines = searchSnapshot(tab);
+	if(showsLargeView(tab)){
+		LargeFileView *view = tab->largeView;
+		// only the lines near the cursor are searched here; the counter finds a match further away
+		bool found = view->findMatch(expression, jump);
+		w->matchCounter->count(lines, expression, view->cursorLineNumber(), view->cursorColumnNumber(), found ? MatchCounter::NoJump : jump == MatchCounter::Previous ? MatchCounter::Previous : MatchCounter::Next);
+	} else {
+		if(!tab->editor->findMatch(expression, jump)){
+			w->matchLabel->setText("No matches");
+			return;
+		}
+		QTextCursor start = tab->editor->textCursor();
+		start.setPosition(start.selectionStart());
+		w->matchCounter->count(lines, expression, start.blockNumber(), start.positionInBlock());
+	}
+	w->matchLabel->setText("Counting...");
+}
+
+void initFindToolBar(Window *w){
+	QToolBar *toolbar = w->findToolBar;
     QAction *close = new QAction(QIcon::fromTheme("window-close"), "Close");
 	QObject::connect(close, &QAction::triggered, toolbar, &QWidget::setVisible);
 	toolbar->addAction(close);
 	
-	QLineEdit *searchBar = new QLineEdit(toolbar);
-	toolbar->addWidget(searchBar);
+	w->searchBar = new QLineEdit(toolbar);
+	toolbar->addWidget(w->searchBar);
 	
 	QAction *up = new QAction(QIcon::fromTheme("go-up"), "Previous");
+	up->setShortcut(QKeySequence::FindPrevious);
 	toolbar->addAction(up);
 	QAction *down = new QAction(QIcon::fromTheme("go-down"), "Next");
+	down->setShortcut(QKeySequence::FindNext);
 	toolbar->addAction(down);
 	
-	QCheckBox *matchCaseCheckbox = new QCheckBox("Match case", toolbar);
-	toolbar->addWidget(matchCaseCheckbox);
-	
-	QCheckBox *regularExpressionCheckbox = new QCheckBox("Regular expression", toolbar);
-	toolbar->addWidget(regularExpressionCheckbox);
+	w->matchCaseCheckbox = new QCheckBox("Match case", toolbar);
+	toolbar->addWidget(w->matchCaseCheckbox);
+	
+	w->regularExpressionCheckbox = new QCheckBox("Regular expression", toolbar);
+	toolbar->addWidget(w->regularExpressionCheckbox);
+	
+	w->matchLabel = new QLabel(toolbar);
+	toolbar->addWidget(w->matchLabel);
+	
+	// search as you type, from the match shown so far
+	QObject::connect(w->searchBar, &QLineEdit::textChanged, [w]{findMatch(w, MatchCounter::NoJump);});
+	QObject::connect(w->searchBar, &QLineEdit::returnPressed, [w]{findMatch(w, MatchCounter::Next);});
+	QObject::connect(up, &QAction::triggered, [w]{findMatch(w, MatchCounter::Previous);});
+	QObject::connect(down, &QAction::triggered, [w]{findMatch(w, MatchCounter::Next);});
+	QObject::connect(w->matchCaseCheckbox, &QCheckBox::toggled, [w]{findMatch(w, MatchCounter::NoJump);});
+	QObject::connect(w->regularExpressionCheckbox, &QCheckBox::toggled, [w]{findMatch(w, MatchCounter::NoJump);});
+	
+	w->matchCounter = new MatchCounter(toolbar);
+	QObject::connect(w->matchCounter, &MatchCounter::found, [w](qint64 line, int column){
+		Tab *tab = currentTab(w);
+		if(tab && showsLargeView(tab)) tab->largeView->goToLine(line, column);
+	});
+	QObject::connect(w->matchCounter, &MatchCounter::counted, [w](int total, int current){
+		QLocale locale;
+		if(total == 0) w->matchLabel->setText("No matches");
+		else if(current > 0) w->matchLabel->setText(locale.toString(current) + " of " + locale.toString(total));
+		else w->matchLabel->setText(locale.toString(total) + (total == 1 ? " match" : " matches"));
+	});
+	QObject::connect(toolbar, &QToolBar::visibilityChanged, [w](bool visible){
+		if(!visible) clearSearch(w);
+	});
 	
 	QLabel *separator = new QLabel(toolbar);
 	separator->setSizePolicy(QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding));
@@ -177,52 +1421,96 @@ void initPrefsWindow(QTabWidget *prefsWin){
     viewLayout->addWidget(displayGroupBox);
 }
 
-void initMenuBar(QMenuBar *bar){
+void showFindToolBar(Window *w){
+	if(!w->findToolBar){
+		w->findToolBar = new QToolBar(w->main);
+		initFindToolBar(w);
+		w->main->addToolBar(Qt::BottomToolBarArea, w->findToolBar);
+	}
+	w->findToolBar->setVisible(true);
+	w->searchBar->setFocus();
+	w->searchBar->selectAll();
+}
+
+void showPrefsWindow(){
+	if(!prefswin){
+		prefswin = new QTabWidget(activeWindow->main);
+		prefswin->setWindowFlags(Qt::Dialog);
+		initPrefsWindow(prefswin);
+	}
+	prefswin->show();
+	prefswin->raise();
+}
+
+void initStatusBar(Window *w, QStatusBar *bar){
+	w->encodingLabel = new QLabel(bar);
+	bar->addPermanentWidget(w->encodingLabel);
+	
+	w->loadLabel = new QLabel(bar);
+	bar->addPermanentWidget(w->loadLabel);
+	
+	w->loadProgress = new QProgressBar(bar);
+	w->loadProgress->setRange(0, 1000);
+	w->loadProgress->setTextVisible(false);
+	w->loadProgress->setMaximumWidth(160);
+	bar->addPermanentWidget(w->loadProgress);
+	
+	w->loadCancelButton = new QPushButton(QIcon::fromTheme("process-stop"), "Cancel", bar);
+	QObject::connect(w->loadCancelButton, &QPushButton::clicked, [w]{
+		Tab *tab = currentTab(w);
+		if(tab && tab->loader) tab->loader->cancel();
+	});
+	bar->addPermanentWidget(w->loadCancelButton);
+	
+	showLoadProgress(w, false);
+}
+
+void initMenuBar(Window *w, QMenuBar *bar){
 	/* File... */
 	QMenu *fileMenu = bar->addMenu("&File");
 	
-	QAction *newFileAction = fileMenu->addAction(QIcon::fromTheme("document-new"), "New");
+	QAction *newFileAction = fileMenu->addAction(QIcon::fromTheme("document-new"), "New", [w]{newTab(w);});
 	newFileAction->setShortcut(QKeySequence(QKeySequence::New));
 	
-	QAction *newWinAction = fileMenu->addAction("New Window");
+	QAction *newWinAction = fileMenu->addAction("New Window", []{newWindow();});
 	newWinAction->setShortcut(QKeySequence(QKeySequence::AddTab));
 	
 	QAction *newFromTemplateAction = fileMenu->addAction("New From Template");
 	
 	fileMenu->addSeparator();
 	
-	QAction *openFileAction = fileMenu->addAction(QIcon::fromTheme("document-open"), "Open");
-	newFileAction->setShortcut(QKeySequence(QKeySequence::Open));
+	QAction *openFileAction = fileMenu->addAction(QIcon::fromTheme("document-open"), "Open", [w]{openFileDialog(w);});
+	openFileAction->setShortcut(QKeySequence(QKeySequence::Open));
 	
 	QAction *openRecentAction = fileMenu->addAction(QIcon::fromTheme("document-open-recent"), "Open Recent");
 	
 	fileMenu->addSeparator();
 	
-	QAction *saveAction = fileMenu->addAction(QIcon::fromTheme("document-save"), "Save");
+	QAction *saveAction = fileMenu->addAction(QIcon::fromTheme("document-save"), "Save", [w]{save(currentTab(w));});
 	saveAction->setShortcut(QKeySequence(QKeySequence::Save));
 	
-	QAction *saveAsAction = fileMenu->addAction(QIcon::fromTheme("document-save-as"), "Save As");
+	QAction *saveAsAction = fileMenu->addAction(QIcon::fromTheme("document-save-as"), "Save As", [w]{saveAs(currentTab(w));});
 	saveAsAction->setShortcut(QKeySequence(QKeySequence::SaveAs));
 	
-	QAction *saveAllAction = fileMenu->addAction("Save All");
+	QAction *saveAllAction = fileMenu->addAction("Save All", saveAll);
 	
 	fileMenu->addSeparator();
 	
 	QAction *printAction = fileMenu->addAction(QIcon::fromTheme("document-print"), "Print");
-	saveAsAction->setShortcut(QKeySequence(QKeySequence::Print));
+	printAction->setShortcut(QKeySequence(QKeySequence::Print));
 	
 	fileMenu->addSeparator();
 	
-	QAction *detachTabAction = fileMenu->addAction("Detach Tab");
+	QAction *detachTabAction = fileMenu->addAction("Detach Tab", [w]{detachTab(w);});
 	
 	fileMenu->addSeparator();
 	
-	QAction *closeTabAction = fileMenu->addAction(QIcon::fromTheme("window-close"), "Close Tab");
+	QAction *closeTabAction = fileMenu->addAction(QIcon::fromTheme("window-close"), "Close Tab", [w]{closeTab(currentTab(w));});
 	closeTabAction->setShortcut(QKeySequence(QKeySequence::Close));
 	
-	QAction *closeWindowAction = fileMenu->addAction("Close Window");
+	QAction *closeWindowAction = fileMenu->addAction("Close Window", [w]{w->main->close();});
 	
-	QAction *quitAction = fileMenu->addAction(QIcon::fromTheme("application-exit"), "Quit", []{exit(0);});
+	QAction *quitAction = fileMenu->addAction(QIcon::fromTheme("application-exit"), "Quit", []{finishSaves(); saveSession(); flushJournals(); exit(0);});
 	quitAction->setShortcut(QKeySequence(QKeySequence::Quit));
 	
 	
@@ -271,90 +1559,173 @@ void initMenuBar(QMenuBar *bar){
 	
 	editMenu->addSeparator();
 	
-	QAction *preferencesAction = editMenu->addAction(QIcon::fromTheme("preferences-system"), "Preferences...");
+	QAction *preferencesAction = editMenu->addAction(QIcon::fromTheme("preferences-system"), "Preferences...", showPrefsWindow);
 	preferencesAction->setShortcut(QKeySequence::Preferences);
 	
 	/* Search... */
 	QMenu *searchMenu = bar->addMenu("&Search");
 	
-	QAction *findAction = searchMenu->addAction(QIcon::fromTheme("edit-find"), "Find");
-	QObject::connect(findAction, &QAction::triggered, [findToolBar]{findToolBar->setVisible(true);});
+	QAction *findAction = searchMenu->addAction(QIcon::fromTheme("edit-find"), "Find", [w]{showFindToolBar(w);});
 	findAction->setShortcut(QKeySequence::Find);
 	
-	QAction *findnReplaceAction = searchMenu->addAction(QIcon::fromTheme("edit-find-replace"), "Find and Replace...");
-	QObject::connect(findnReplaceAction, &QAction::triggered, [findnReplaceWindow]{findnReplaceWindow->setVisible(true);});
+	QAction *findnReplaceAction = searchMenu->addAction(QIcon::fromTheme("edit-find-replace"), "Find and Replace...", showFindnReplaceWindow);
 	findnReplaceAction->setShortcut(QKeySequence::Replace);
 	
-	QAction *gotoAction = searchMenu->addAction(QIcon::fromTheme("go-next"), "Go to");
-	QObject::connect(gotoAction, &QAction::triggered, [gotoWindow]{gotoWindow->setVisible(true);});
+	QAction *gotoAction = searchMenu->addAction(QIcon::fromTheme("go-next"), "Go to", showGotoWindow);
+	gotoAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_L));
 	
 	
 	/* View... */
 	QMenu *viewMenu = bar->addMenu("&View");
 	
-	QAction *fontAction = viewMenu->addAction(QIcon::fromTheme("preferences-desktop-font"), "Font...");
-	QObject::connect(fontAction, &QAction::triggered, []{fontWindow->setVisible(true);});
+	QAction *fontAction = viewMenu->addAction(QIcon::fromTheme("preferences-desktop-font"), "Font...", showFontWindow);
 	
 	editMenu->addSeparator();
     
     QMenu *colorSchemeMenu = viewMenu->addMenu("Color Scheme");
 	
-	QAction *lineNumbersAction = viewMenu->addAction("Line numbers");
-	lineNumbersAction->setCheckable(true);
-	QObject::connect(lineNumbersAction, &QAction::toggled, editor, &CodeEditor::disableLineNumbers);
+	w->lineNumbersAction = viewMenu->addAction("Line numbers");
+	w->lineNumbersAction->setCheckable(true);
+	w->lineNumbersAction->setChecked(lineNumbersDisabled);
+	QObject::connect(w->lineNumbersAction, &QAction::toggled, setLineNumbersDisabled);
+	
+	w->splitAction = viewMenu->addAction("Split View");
+	w->splitAction->setCheckable(true);
+	QObject::connect(w->splitAction, &QAction::toggled, [w](bool split){setSplit(currentTab(w), split);});
+	
+	w->followAction = viewMenu->addAction("Follow File");
+	w->followAction->setCheckable(true);
+	QObject::connect(w->followAction, &QAction::toggled, [w](bool follow){setFollowing(currentTab(w), follow);});
+	
+	
+	/* Document... */
+	QMenu *documentMenu = bar->addMenu("&Document");
+	
+	QMenu *lineEndingMenu = documentMenu->addMenu("Line Ending");
+	w->lineEndingGroup = new QActionGroup(lineEndingMenu);
+	QAction *lfAction = lineEndingMenu->addAction("Unix (LF)");
+	lfAction->setData(LineEndings::Lf);
+	QAction *crlfAction = lineEndingMenu->addAction("DOS / Windows (CR LF)");
+	crlfAction->setData(LineEndings::CrLf);
+	QAction *crAction = lineEndingMenu->addAction("Mac (CR)");
+	crAction->setData(LineEndings::Cr);
+	for(QAction *action : lineEndingMenu->actions()){
+		action->setCheckable(true);
+		w->lineEndingGroup->addAction(action);
+	}
+	lfAction->setChecked(true);
+	QObject::connect(w->lineEndingGroup, &QActionGroup::triggered, [w](QAction *action){setLineEndingStyle(currentTab(w), LineEndings::Style(action->data().toInt()));});
+	
+	w->compressAction = documentMenu->addAction("Compress on Save");
+	w->compressAction->setCheckable(true);
+	w->compressAction->setEnabled(false);
+	QObject::connect(w->compressAction, &QAction::toggled, [w](bool compress){
+		Tab *tab = currentTab(w);
+		if(tab->editor) tab->editor->setCompression(compress ? tab->compression : Compression::None);
+	});
+	
+	documentMenu->addSeparator();
+	documentMenu->addAction("Memory Usage", [w]{showMemoryUsage(w);});
+}
+
+// A main window with an empty tab, made active.
+Window *newWindow(){
+	Window *w = new Window();
+	w->main = new QMainWindow();
+	w->main->setWindowTitle("Mousepad");
+	w->main->setWindowIcon(QIcon("icons/"));
+	windows.append(w);
+	if(!activeWindow) activeWindow = w;
+	w->main->installEventFilter(new WindowWatcher(w));
+	
+	w->tabs = new QTabWidget(w->main);
+	w->tabs->setDocumentMode(true);
+	w->tabs->setTabsClosable(true);
+	w->tabs->setMovable(true);
+	w->tabs->tabBar()->setAutoHide(true);
+	QObject::connect(w->tabs, &QTabWidget::currentChanged, [w]{showTab(w);});
+	QObject::connect(w->tabs, &QTabWidget::tabCloseRequested, [w](int index){closeTab(tabs.value(w->tabs->widget(index)));});
+	w->main->setCentralWidget(w->tabs);
+	
+	initStatusBar(w, w->main->statusBar());
+	QMenuBar *menubar = new QMenuBar(w->main);
+	initMenuBar(w, menubar);
+	w->main->setMenuBar(menubar);
+	startupPhase("menus");
+	
+	newTab(w);
+	startupPhase("editor");
+	
+	w->main->show();
+	startupPhase("show");
+	return w;
 }
 
 int main(int argc, char** argv){
+	// Milliseconds of each phase up to the first paint, on stderr
+	if(qEnvironmentVariableIsSet("MOUSEPAD_STARTUP_TIMING")) startupClock.start();
+	
+	// Single-instance mode: a running mousepad takes the files, before anything is set up here
+	bool singleInstance = qEnvironmentVariableIntValue("MOUSEPAD_SINGLE_INSTANCE") != 0;
+	if(singleInstance && InstanceServer::forward(argc, argv)) return 0;
+	
 	QApplication *app = new QApplication(argc, argv);
     QCoreApplication::setOrganizationName("xfce4-qt");
     QCoreApplication::setOrganizationDomain("xfce4.org");
     QCoreApplication::setApplicationName("mousepad");
+	startupPhase("application");
 	
-	settings = new QSettings();
-	
-	QMainWindow *mainwin = new QMainWindow();
-	mainwin->setWindowTitle("Mousepad");
-	mainwin->setWindowIcon(QIcon("icons/"));
+	// Chrome trace of load, highlight, layout and paint spans
+	QString traceOutput = qEnvironmentVariable("MOUSEPAD_TRACE");
+	if(!traceOutput.isEmpty()) Trace::start(traceOutput);
 	
-	findnReplaceWindow = new QDialog(mainwin);
-	initFindnReplaceWindow(findnReplaceWindow);
-	findnReplaceWindow->setVisible(false);
-	
-	gotoWindow = new QDialog(mainwin);
-	initGotoWindow(gotoWindow);
-	gotoWindow->setVisible(false);
+	settings = new QSettings();
+	startupPhase("settings");
 	
 	QString fontData = settings->value("FontData").toString();
-	QFont font;
 	if(!fontData.isNull()){
-		if(!(font.fromString(fontData))){
+		if(!(editorFont.fromString(fontData))){
 			QErrorMessage badFontDataMsg;
 			badFontDataMsg.showMessage("Bad font data stored in config");
-			font = QFont("Monospaced");
+			editorFont = QFont("Monospaced");
 		}
-	} else font = QFont("Monospaced");
-	editor = new CodeEditor(font, mainwin);
-	mainwin->setCentralWidget(editor);
+	} else editorFont = QFont("Monospaced");
+	
+	saver = new AsyncSaver(app);
+	initSaver(saver);
+	
+	hibernator = new Hibernator(app);
+	initHibernator(hibernator);
+	
+	if(singleInstance){
+		instanceServer = new InstanceServer(app);
+		initInstanceServer(instanceServer);
+		if(!instanceServer->listen()) qWarning("Failed to listen for other launches");
+	}
+	
+	// Opt-in recording of the edit session of the document shown, for replay-trace
+	QString tracePath = qEnvironmentVariable("MOUSEPAD_RECORD_TRACE");
+	if(!tracePath.isEmpty()) recorder = new EditRecorder(tracePath, app);
+	
+	Window *w = newWindow();
+	
+	// the session, then what was left unsaved, then the files asked for, each showing over the last
+	QStringList args = app->arguments();
+	if(args.size() <= 1) restoreSession(w);
+	recoverJournal(w);
+	for(int i = 1; i < args.size(); ++i){
+		if(!openFileInTab(w, args.at(i))) qWarning("Failed to open %s", qPrintable(args.at(i)));
+	}
+	startupPhase("open file");
+	
+	// the view showing when the event loop starts is the one painted first
+	Tab *shownTab = currentTab(w);
+	QAbstractScrollArea *shown = showsLargeView(shownTab) ? static_cast<QAbstractScrollArea *>(shownTab->largeView) : shownTab->editor;
+	if(startupClock.isValid() && shown) shown->viewport()->installEventFilter(new FirstPaintWatcher(w->main));
 	
-	fontWindow = new QFontDialog(editor->document()->defaultFont(), mainwin);
-	initFontWindow(fontWindow);
-	fontWindow->setVisible(false);
-    
-	findToolBar = new QToolBar(mainwin);
-	initFindToolBar(findToolBar);
-	findToolBar->setVisible(false);
-	mainwin->addToolBar(Qt::BottomToolBarArea, findToolBar);
-	
-	QMenuBar *menubar = new QMenuBar(mainwin);
-	initMenuBar(menubar);
-	mainwin->setMenuBar(menubar);
-	
-    prefswin = new QTabWidget();
-	prefswin->setWindowFlags(Qt::Dialog);
-    initPrefsWindow(prefswin);
-    prefswin->show();
-    
-    mainwin->show();
-    
 	app->exec();
+	finishSaves();
+	saveSession();
+	// unsaved changes stay recoverable
+	flushJournals();
 }
@@ -0,0 +1,69 @@
+#include "mappedfile.h"
+#include "trace.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+    bytes(nullptr),
+    length(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const QString &fileName)
+{
+    TraceSpan span("io", "mapFile");
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    length = file.size();
+    if (length == 0)
+        return true; // an empty file cannot be mapped
+    bytes = file.map(0, length);
+    if (!bytes) {
+        file.close();
+        length = 0;
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    /* the first pass over the file is the newline scan */
+    madvise(bytes, size_t(length), MADV_SEQUENTIAL);
+#endif
+    span.arg("bytes", length);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        file.unmap(bytes);
+    bytes = nullptr;
+    length = 0;
+    file.close();
+}
+
+void MappedFile::release(qint64 offset, qint64 count)
+{
+#ifdef Q_OS_UNIX
+    if (!bytes)
+        return;
+    static const qint64 pageSize = sysconf(_SC_PAGESIZE);
+    /* only whole pages inside the range */
+    qint64 first = (offset + pageSize - 1) / pageSize * pageSize;
+    qint64 last = qMin(offset + count, length) / pageSize * pageSize;
+    if (last > first)
+        madvise(bytes + first, size_t(last - first), MADV_DONTNEED);
+#else
+    Q_UNUSED(offset);
+    Q_UNUSED(count);
+#endif
+}
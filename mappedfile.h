@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QFile>
+
+/* A read-only memory mapping of a whole file. Nothing is read until
+   the pages are touched, so opening costs the same for any size. */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const QString &fileName);
+    void close();
+
+    bool isOpen() const { return bytes != nullptr || (file.isOpen() && length == 0); }
+    QString fileName() const { return file.fileName(); }
+    QString errorString() const { return file.errorString(); }
+    /* The descriptor of the file, for copying ranges of it. */
+    int handle() const { return file.handle(); }
+
+    const char *data() const { return reinterpret_cast<const char *>(bytes); }
+    qint64 size() const { return length; }
+
+    /* Drops the pages of a range from the process; they stay in the page
+       cache and are read again if touched. Keeps a one-pass scan of a
+       huge file from counting it all as resident memory. */
+    void release(qint64 offset, qint64 count);
+
+private:
+    Q_DISABLE_COPY(MappedFile)
+
+    QFile file;
+    uchar *bytes;
+    qint64 length;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "matchcounter.h"
+#include "trace.h"
+
+#include <QPointer>
+#include <QThreadPool>
+
+// A match of a count, with its number from 1; number 0 when there is none.
+struct CountedMatch
+{
+    qint64 line;
+    int column;
+    int length;
+    int number;
+};
+
+MatchCounter::MatchCounter(QObject *parent) : QObject(parent),
+    runs(0)
+{
+}
+
+MatchCounter::~MatchCounter()
+{
+    cancel();
+}
+
+void MatchCounter::count(const LineSnapshot &lines, const QRegularExpression &expression,
+                         qint64 line, int column, Jump jump)
+{
+    cancel();
+    const int run = ++runs;
+    const QSharedPointer<QAtomicInt> canceled(new QAtomicInt(0));
+    canceledFlag = canceled;
+    QPointer<MatchCounter> self(this);
+    QThreadPool::globalInstance()->start([self, run, canceled, lines, expression, line, column, jump] {
+        TraceSpan span("app", "countMatches");
+        const CountedMatch none = { 0, 0, 0, 0 };
+        CountedMatch first = none, last = none; // of the whole text
+        CountedMatch current = none, next = none, previous = none;
+        int total = 0;
+        qint64 number = 0;
+        lines([&](const QString &text) {
+            if (canceled->loadRelaxed())
+                return false;
+            QRegularExpressionMatchIterator matches = expression.globalMatch(text);
+            while (matches.hasNext()) {
+                const QRegularExpressionMatch match = matches.next();
+                if (match.capturedLength() == 0)
+                    continue;
+                const CountedMatch counted = { number, int(match.capturedStart()), int(match.capturedLength()), ++total };
+                if (!first.number)
+                    first = counted;
+                last = counted;
+                const bool before = number < line || (number == line && counted.column < column);
+                if (before) {
+                    previous = counted;
+                    continue;
+                }
+                if (counted.line == line && counted.column == column && !current.number)
+                    current = counted;
+                if (!next.number && (jump != Next || number > line || counted.column > column)) {
+                    next = counted;
+                    /* the rest is only counted */
+                    if (jump == Next)
+                        QMetaObject::invokeMethod(self, [self, run, counted] {
+                            if (self && self->runs == run)
+                                emit self->found(counted.line, counted.column, counted.length);
+                        }, Qt::QueuedConnection);
+                }
+            }
+            ++number;
+            return true;
+        });
+        span.arg("lines", number);
+        span.arg("matches", total);
+        if (canceled->loadRelaxed())
+            return;
+
+        const bool wrapped = jump == Next && !next.number;
+        if (jump == Next)
+            current = next.number ? next : first;
+        else if (jump == Previous)
+            current = previous.number ? previous : last;
+        QMetaObject::invokeMethod(self, [self, run, jump, wrapped, current, total] {
+            if (!self || self->runs != run)
+                return;
+            if (current.number && (wrapped || jump == Previous))
+                emit self->found(current.line, current.column, current.length);
+            emit self->counted(total, current.number);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MatchCounter::cancel()
+{
+    ++runs; // drops what was sent but not yet received
+    if (canceledFlag)
+        canceledFlag->storeRelaxed(1);
+    canceledFlag.clear();
+}
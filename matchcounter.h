@@ -0,0 +1,51 @@
+#ifndef MATCHCOUNTER_H
+#define MATCHCOUNTER_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QRegularExpression>
+#include <QSharedPointer>
+
+#include <functional>
+
+/* Takes each line of a text, in order, until it returns false. */
+typedef std::function<bool(const QString &line)> LineVisitor;
+/* A snapshot of a text that hands its lines to a visitor; called on a
+   worker thread, so it must not refer to the document it was taken of. */
+typedef std::function<void(const LineVisitor &visit)> LineSnapshot;
+
+/* Counts the matches of a search in a snapshot of a document on a
+   thread of the global pool, for "n of N" in the find bar. A new count
+   cancels the one going on, which stops at its next line, so typing in
+   the search box never waits for a count. Matches do not span lines
+   and empty matches are not counted, as in the views. */
+class MatchCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /* Which match to look for besides counting. */
+    enum Jump { NoJump, Next, Previous };
+
+    explicit MatchCounter(QObject *parent = nullptr);
+    ~MatchCounter();
+
+    /* Counts the matches of expression, taking the one that starts at
+       line and column as the current one, or with jump, the next one
+       from there or the previous one before it, wrapping around. */
+    void count(const LineSnapshot &lines, const QRegularExpression &expression,
+               qint64 line, int column, Jump jump = NoJump);
+    void cancel();
+
+signals:
+    /* The match jumped to; for Next, sent as soon as it is reached. */
+    void found(qint64 line, int column, int length);
+    /* current is the number of the current match from 1, or 0. */
+    void counted(int total, int current);
+
+private:
+    int runs; // the last count, whose results are the only ones used
+    QSharedPointer<QAtomicInt> canceledFlag;
+};
+
+#endif
@@ -7,6 +7,6 @@ TARGET = mousepad
 INCLUDEPATH += .
 
 # Input
-SOURCES += codeeditor.cpp main.cpp ./highlighter/*.cpp
-HEADERS += codeeditor.h ./highlighter/*.h
+SOURCES += asyncsaver.cpp codeeditor.cpp compression.cpp editjournal.cpp editrecorder.cpp fileloader.cpp filereloader.cpp hibernator.cpp instanceserver.cpp largefileview.cpp linediff.cpp lineendings.cpp lineindex.cpp logfollower.cpp main.cpp mappedfile.cpp matchcounter.cpp piecetable.cpp session.cpp textencoding.cpp textwriter.cpp trace.cpp ./highlighter/*.cpp
+HEADERS += asyncsaver.h codeeditor.h compression.h editjournal.h editrecorder.h fileloader.h filereloader.h hibernator.h instanceserver.h largefileview.h linediff.h lineendings.h lineindex.h logfollower.h mappedfile.h matchcounter.h piecetable.h session.h textencoding.h textwriter.h trace.h ./highlighter/*.h
 QT += widgets
\ No newline at end of file
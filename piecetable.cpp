@@ -0,0 +1,364 @@
+#include "piecetable.h"
+#include "lineindex.h"
+
+#include <algorithm>
+#include <cstring>
+
+struct PieceTable::Node
+{
+    bool added;         // the piece is in the add buffer, not in the original
+    qint64 start;
+    qint64 length;
+    qint64 newlines;
+    quint32 priority;
+    /* totals of the subtree rooted here */
+    qint64 bytes;
+    qint64 lines;
+    int count;
+    Node *left;
+    Node *right;
+};
+
+PieceTable::PieceTable() :
+    original(nullptr),
+    index(nullptr),
+    root(nullptr),
+    seed(2463534242u),
+    modified(false)
+{
+}
+
+PieceTable::~PieceTable()
+{
+    destroy(root);
+}
+
+void PieceTable::reset(const char *original, qint64 size, const LineIndex *index)
+{
+    Q_ASSERT(index->isComplete());
+    clear();
+    this->original = original;
+    this->index = index;
+    if (size > 0) {
+        root = newPiece(false, 0, size);
+        root->newlines = index->lineCount() - 1;
+        update(root);
+    }
+}
+
+void PieceTable::clear()
+{
+    destroy(root);
+    root = nullptr;
+    added.clear();
+    modified = false;
+}
+
+qint64 PieceTable::size() const
+{
+    return bytesOf(root);
+}
+
+qint64 PieceTable::lineCount() const
+{
+    return linesOf(root) + 1;
+}
+
+int PieceTable::pieceCount() const
+{
+    return root ? root->count : 0;
+}
+
+inline qint64 PieceTable::bytesOf(const Node *node)
+{
+    return node ? node->bytes : 0;
+}
+
+inline qint64 PieceTable::linesOf(const Node *node)
+{
+    return node ? node->lines : 0;
+}
+
+const char *PieceTable::pieceData(const Node *node) const
+{
+    return (node->added ? added.constData() : original) + node->start;
+}
+
+qint64 PieceTable::countNewlines(bool inAdded, qint64 from, qint64 to) const
+{
+    if (!inAdded)
+        return index->lineAt(to) - index->lineAt(from);
+    const char *data = added.constData();
+    return std::count(data + from, data + to, terminator());
+}
+
+PieceTable::Node *PieceTable::newPiece(bool inAdded, qint64 start, qint64 length)
+{
+    /* xorshift32 */
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    Node *node = new Node;
+    node->added = inAdded;
+    node->start = start;
+    node->length = length;
+    node->newlines = 0;
+    node->priority = seed;
+    node->left = nullptr;
+    node->right = nullptr;
+    update(node);
+    return node;
+}
+
+void PieceTable::update(Node *node) const
+{
+    node->bytes = bytesOf(node->left) + node->length + bytesOf(node->right);
+    node->lines = linesOf(node->left) + node->newlines + linesOf(node->right);
+    node->count = (node->left ? node->left->count : 0) + 1 + (node->right ? node->right->count : 0);
+}
+
+PieceTable::Node *PieceTable::merge(Node *left, Node *right)
+{
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+    if (left->priority > right->priority) {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+    }
+    right->left = merge(left, right->left);
+    update(right);
+    return right;
+}
+
+/* Splits a subtree into the pieces before pos and those after it,
+   cutting the piece that contains pos in two if needed. */
+void PieceTable::split(Node *node, qint64 pos, Node *&left, Node *&right)
+{
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+    const qint64 leftBytes = bytesOf(node->left);
+    if (pos <= leftBytes) {
+        split(node->left, pos, left, node->left);
+        update(node);
+        right = node;
+    } else if (pos >= leftBytes + node->length) {
+        split(node->right, pos - leftBytes - node->length, node->right, right);
+        update(node);
+        left = node;
+    } else {
+        const qint64 offset = pos - leftBytes;
+        Node *tail = newPiece(node->added, node->start + offset, node->length - offset);
+        const qint64 headLines = countNewlines(node->added, node->start, node->start + offset);
+        tail->newlines = node->newlines - headLines;
+        update(tail);
+        node->length = offset;
+        node->newlines = headLines;
+
+        right = merge(tail, node->right);
+        node->right = nullptr;
+        update(node);
+        left = node;
+    }
+}
+
+void PieceTable::destroy(Node *node)
+{
+    if (!node)
+        return;
+    destroy(node->left);
+    destroy(node->right);
+    delete node;
+}
+
+void PieceTable::insert(qint64 pos, const QByteArray &text)
+{
+    if (text.isEmpty())
+        return;
+    pos = qBound(Q_INT64_C(0), pos, size());
+    modified = true;
+
+    const qint64 lines = std::count(text.constBegin(), text.constEnd(), terminator());
+    Node *left, *right;
+    split(root, pos, left, right);
+
+    /* typing extends the piece it has just added, instead of adding
+       one piece per character */
+    Node *last = left;
+    while (last && last->right)
+        last = last->right;
+    if (last && last->added && last->start + last->length == added.size()) {
+        for (Node *node = left; node; node = node->right) {
+            node->bytes += text.size();
+            node->lines += lines;
+        }
+        last->length += text.size();
+        last->newlines += lines;
+        added.append(text);
+    } else {
+        Node *piece = newPiece(true, added.size(), text.size());
+        piece->newlines = lines;
+        update(piece);
+        added.append(text);
+        left = merge(left, piece);
+    }
+    root = merge(left, right);
+}
+
+void PieceTable::remove(qint64 pos, qint64 length)
+{
+    pos = qBound(Q_INT64_C(0), pos, size());
+    length = qMin(length, size() - pos);
+    if (length <= 0)
+        return;
+    modified = true;
+
+    Node *left, *middle, *right;
+    split(root, pos, left, right);
+    split(right, length, middle, right);
+    destroy(middle);
+    root = merge(left, right);
+}
+
+void PieceTable::collect(const Node *node, qint64 pos, qint64 end, QByteArray &out) const
+{
+    if (!node || pos >= end)
+        return;
+    const qint64 leftBytes = bytesOf(node->left);
+    const qint64 pieceEnd = leftBytes + node->length;
+    if (pos < leftBytes)
+        collect(node->left, pos, qMin(end, leftBytes), out);
+    const qint64 from = qMax(pos, leftBytes);
+    const qint64 to = qMin(end, pieceEnd);
+    if (from < to)
+        out.append(pieceData(node) + (from - leftBytes), int(to - from));
+    if (end > pieceEnd)
+        collect(node->right, qMax(Q_INT64_C(0), pos - pieceEnd), end - pieceEnd, out);
+}
+
+QByteArray PieceTable::text(qint64 pos, qint64 length) const
+{
+    QByteArray out;
+    pos = qBound(Q_INT64_C(0), pos, size());
+    length = qMin(length, size() - pos);
+    if (length <= 0)
+        return out;
+    out.reserve(int(length));
+    collect(root, pos, pos + length, out);
+    return out;
+}
+
+void PieceTable::collectPieces(const Node *node, QVector<Piece> &out) const
+{
+    if (!node)
+        return;
+    collectPieces(node->left, out);
+    Piece piece = { node->added, node->start, node->length };
+    out.append(piece);
+    collectPieces(node->right, out);
+}
+
+QVector<PieceTable::Piece> PieceTable::pieces() const
+{
+    QVector<Piece> out;
+    out.reserve(pieceCount());
+    collectPieces(root, out);
+    return out;
+}
+
+char PieceTable::at(qint64 pos) const
+{
+    const Node *node = root;
+    while (node) {
+        const qint64 leftBytes = bytesOf(node->left);
+        if (pos < leftBytes) {
+            node = node->left;
+        } else if (pos < leftBytes + node->length) {
+            return pieceData(node)[pos - leftBytes];
+        } else {
+            pos -= leftBytes + node->length;
+            node = node->right;
+        }
+    }
+    return 0;
+}
+
+char PieceTable::terminator() const
+{
+    return index ? index->terminator() : '\n';
+}
+
+/* The offset of the n-th newline, counting from 1. */
+qint64 PieceTable::newlineOffset(qint64 n) const
+{
+    qint64 base = 0;
+    const Node *node = root;
+    while (node) {
+        const qint64 leftLines = linesOf(node->left);
+        if (n <= leftLines) {
+            node = node->left;
+            continue;
+        }
+        n -= leftLines;
+        base += bytesOf(node->left);
+        if (n <= node->newlines) {
+            if (!node->added) {
+                qint64 line = index->lineAt(node->start) + n;
+                return base + index->lineStart(line) - 1 - node->start;
+            }
+            const char *data = pieceData(node);
+            const char *p = data;
+            for (;;) {
+                p = static_cast<const char *>(std::memchr(p, terminator(), size_t(data + node->length - p)));
+                if (--n == 0)
+                    return base + (p - data);
+                ++p;
+            }
+        }
+        n -= node->newlines;
+        base += node->length;
+        node = node->right;
+    }
+    return size();
+}
+
+qint64 PieceTable::lineStart(qint64 line) const
+{
+    line = qBound(Q_INT64_C(0), line, lineCount() - 1);
+    return line == 0 ? 0 : newlineOffset(line) + 1;
+}
+
+qint64 PieceTable::lineEnd(qint64 line) const
+{
+    const qint64 start = lineStart(line);
+    qint64 end = line + 1 < lineCount() ? newlineOffset(line + 1) : size();
+    if (terminator() == '\n' && end > start && at(end - 1) == '\r')
+        --end;
+    return end;
+}
+
+qint64 PieceTable::lineAt(qint64 pos) const
+{
+    pos = qBound(Q_INT64_C(0), pos, size());
+    qint64 line = 0;
+    const Node *node = root;
+    while (node) {
+        const qint64 leftBytes = bytesOf(node->left);
+        if (pos < leftBytes) {
+            node = node->left;
+        } else if (pos < leftBytes + node->length) {
+            return line + linesOf(node->left)
+                    + countNewlines(node->added, node->start, node->start + pos - leftBytes);
+        } else {
+            line += linesOf(node->left) + node->newlines;
+            pos -= leftBytes + node->length;
+            node = node->right;
+        }
+    }
+    return line;
+}
@@ -0,0 +1,86 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QByteArray>
+#include <QVector>
+
+class LineIndex;
+
+/* An editable text made of pieces of two buffers: the original one,
+   usually a memory-mapped file that is never copied, and an append-only
+   buffer that holds everything typed or pasted. The pieces are kept in
+   a treap ordered by position, where every node also knows the bytes
+   and newlines of its subtree, so edits and line lookups are O(log n)
+   in the number of pieces whatever the size of the text.
+
+   Positions are byte offsets into the UTF-8 text. Newlines of the
+   original buffer are counted with its LineIndex, which must be
+   complete; a newline is the terminator of that index, in added text
+   too. */
+class PieceTable
+{
+public:
+    struct Piece
+    {
+        bool added; // in addBuffer(), not in the original
+        qint64 start;
+        qint64 length;
+    };
+
+    PieceTable();
+    ~PieceTable();
+
+    void reset(const char *original, qint64 size, const LineIndex *index);
+    void clear();
+
+    qint64 size() const;
+    qint64 lineCount() const;
+    /* True once the text differs from the original buffer. */
+    bool isModified() const { return modified; }
+    int pieceCount() const;
+
+    void insert(qint64 pos, const QByteArray &text);
+    void remove(qint64 pos, qint64 length);
+
+    QByteArray text(qint64 pos, qint64 length) const;
+    char at(qint64 pos) const;
+
+    /* The pieces in text order. With a copy of the add buffer, which is
+       shared until the next insertion, they are a snapshot of the text
+       for as long as the original buffer lives. */
+    QVector<Piece> pieces() const;
+    const QByteArray &addBuffer() const { return added; }
+
+    /* The same conventions as LineIndex. */
+    qint64 lineStart(qint64 line) const;
+    qint64 lineEnd(qint64 line) const;
+    qint64 lineAt(qint64 pos) const;
+
+private:
+    Q_DISABLE_COPY(PieceTable)
+
+    struct Node;
+
+    static qint64 bytesOf(const Node *node);
+    static qint64 linesOf(const Node *node);
+    const char *pieceData(const Node *node) const;
+    char terminator() const;
+    qint64 countNewlines(bool added, qint64 from, qint64 to) const;
+    Node *newPiece(bool added, qint64 start, qint64 length);
+    void update(Node *node) const;
+    Node *merge(Node *left, Node *right);
+    void split(Node *node, qint64 pos, Node *&left, Node *&right);
+    void destroy(Node *node);
+    void collect(const Node *node, qint64 pos, qint64 end, QByteArray &out) const;
+    void collectPieces(const Node *node, QVector<Piece> &out) const;
+    qint64 newlineOffset(qint64 n) const;
+
+    const char *original;
+    const LineIndex *index;
+    QByteArray added;
+    Node *root;
+    quint32 seed;
+    bool modified;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "session.h"
+#include "trace.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+static const char magic[] = { 'M', 'P', 'S', 'S' };
+static const quint8 version = 1;
+
+QString Session::fileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/session";
+}
+
+Session Session::load()
+{
+    TraceSpan span("session", "load");
+    Session session;
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return session;
+    QByteArray header = file.read(sizeof(magic) + 1);
+    if (header.size() != int(sizeof(magic)) + 1 || !header.startsWith(QByteArray(magic, sizeof(magic)))
+            || quint8(header.at(sizeof(magic))) != version)
+        return session;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+    qint32 current, count;
+    in >> current >> count;
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Document document;
+        qint32 column;
+        quint8 encoding, endings, compression;
+        in >> document.fileName >> document.cursorLine >> column >> document.firstLine
+           >> encoding >> endings >> compression;
+        document.cursorColumn = column;
+        document.encoding = TextEncoding::Encoding(encoding);
+        document.lineEndings = LineEndings::Style(endings);
+        document.compression = Compression::Format(compression);
+        session.documents.append(document);
+    }
+    if (in.status() != QDataStream::Ok)
+        return Session();
+    session.current = current >= 0 && current < session.documents.size() ? current : -1;
+    span.arg("documents", session.documents.size());
+    return session;
+}
+
+bool Session::save() const
+{
+    TraceSpan span("session", "save");
+    if (!QDir().mkpath(QFileInfo(fileName()).path()))
+        return false;
+    QSaveFile file(fileName());
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(magic, sizeof(magic));
+    file.write(reinterpret_cast<const char *>(&version), 1);
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << qint32(current) << qint32(documents.size());
+    for (const Document &document : documents) {
+        out << document.fileName << document.cursorLine << qint32(document.cursorColumn) << document.firstLine
+            << quint8(document.encoding) << quint8(document.lineEndings) << quint8(document.compression);
+    }
+    span.arg("documents", documents.size());
+    return out.status() == QDataStream::Ok && file.commit();
+}
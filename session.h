@@ -0,0 +1,52 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <QString>
+#include <QVector>
+#include "compression.h"
+#include "lineendings.h"
+#include "textencoding.h"
+
+/* The documents that were open when mousepad quit, kept in one small
+   file so that restoring costs the same however much was open. Each
+   entry says where its view was and how its file was read, so only the
+   current document has to be read at startup; the others can wait
+   until they are shown.
+
+   The file is "MPSS", a version byte, then a QDataStream of the index
+   of the current document and the entries. */
+class Session
+{
+public:
+    struct Document
+    {
+        Document() :
+            cursorLine(0),
+            cursorColumn(0),
+            firstLine(0),
+            encoding(TextEncoding::Utf8),
+            lineEndings(LineEndings::Lf),
+            compression(Compression::None)
+        {}
+
+        QString fileName;
+        qint64 cursorLine;
+        int cursorColumn;
+        qint64 firstLine; // at the top of the view
+        TextEncoding::Encoding encoding;
+        LineEndings::Style lineEndings;
+        Compression::Format compression;
+    };
+
+    Session() : current(-1) {}
+
+    static QString fileName();
+    /* An empty session if there is none or it cannot be read. */
+    static Session load();
+    bool save() const;
+
+    QVector<Document> documents;
+    int current; // index into documents, or -1
+};
+
+#endif
@@ -0,0 +1,409 @@
+#include "textencoding.h"
+#include "trace.h"
+
+#include <QSysInfo>
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The lookup validator needs SSSE3, which is checked for at run time,
+   as builds for x86-64 only assume SSE2. */
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define LOOKUP_VALIDATION
+#define LOOKUP_TARGET __attribute__((target("ssse3")))
+#include <tmmintrin.h>
+#endif
+
+// Bytes looked at for the zero bytes of UTF-16.
+static const int utf16Sample = 4096;
+
+static inline bool isContinuation(uchar c)
+{
+    return (c & 0xC0) == 0x80;
+}
+
+/* Validates one sequence starting with a non-ASCII byte. Returns its
+   length, 0 if it is invalid, or -1 if the data ends inside it. */
+static int sequenceLength(const uchar *p, const uchar *end)
+{
+    const uchar c = *p;
+    int length;
+    uchar min = 0x80, max = 0xBF; // range of the second byte
+    if (c >= 0xC2 && c <= 0xDF) {
+        length = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        length = 3;
+        if (c == 0xE0)
+            min = 0xA0; // overlong
+        else if (c == 0xED)
+            max = 0x9F; // surrogates
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        length = 4;
+        if (c == 0xF0)
+            min = 0x90; // overlong
+        else if (c == 0xF4)
+            max = 0x8F; // above U+10FFFF
+    } else {
+        return 0;
+    }
+
+    for (int i = 1; i < length; ++i) {
+        if (p + i >= end)
+            return -1;
+        if (i == 1 ? (p[1] < min || p[1] > max) : !isContinuation(p[i]))
+            return 0;
+    }
+    return length;
+}
+
+/* The start of the sequence that p is in the middle of, if one started
+   in the three bytes before it; else p. */
+static const uchar *sequenceStart(const uchar *begin, const uchar *p)
+{
+    for (int i = 1; i <= 3 && p - begin >= i; ++i) {
+        const uchar c = p[-i];
+        if (isContinuation(c))
+            continue;
+        const int length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+        return length > i ? p - i : p;
+    }
+    return p;
+}
+
+#ifdef LOOKUP_VALIDATION
+/* The error classes of the lookup validator; a byte is invalid when the
+   classes of its high nibble, of the low and high nibbles of the byte
+   before it all share a bit. */
+enum {
+    TooShort = 1 << 0, // a lead not followed by enough continuations
+    TooLong = 1 << 1, // a continuation after ASCII
+    Overlong3 = 1 << 2,
+    TooLarge = 1 << 3,
+    Surrogate = 1 << 4,
+    Overlong2 = 1 << 5,
+    TooLarge1000 = 1 << 6,
+    Overlong4 = 1 << 6,
+    TwoConts = 1 << 7, // a continuation after a continuation
+    Carry = TooShort | TooLong | TwoConts
+};
+
+/* The bits of the bytes of input that are invalid: the classes looked
+   up for each byte and the one before it, with the continuations that
+   a 3- or 4-byte lead two or three bytes back requires. */
+LOOKUP_TARGET static inline __m128i invalidBytes(__m128i input, __m128i previous)
+{
+    const __m128i byte1High = _mm_setr_epi8(
+        TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+        TwoConts, TwoConts, TwoConts, TwoConts,
+        TooShort | Overlong2, TooShort, TooShort | Overlong3 | Surrogate,
+        TooShort | TooLarge | TooLarge1000 | Overlong4);
+    const __m128i byte1Low = _mm_setr_epi8(
+        Carry | Overlong3 | Overlong2 | Overlong4, Carry | Overlong2, Carry, Carry,
+        Carry | TooLarge, Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000 | Surrogate,
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000);
+    const __m128i byte2High = _mm_setr_epi8(
+        TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+        char(TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4),
+        char(TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge),
+        char(TooLong | Overlong2 | TwoConts | Surrogate | TooLarge),
+        char(TooLong | Overlong2 | TwoConts | Surrogate | TooLarge),
+        TooShort, TooShort, TooShort, TooShort);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+
+    const __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    const __m128i special = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                      _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, nibble))),
+        _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+    /* only 111xxxxx two bytes back and 1111xxxx three bytes back keep
+       their high bit */
+    const __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 14), _mm_set1_epi8(char(0xE0 - 0x80)));
+    const __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 13), _mm_set1_epi8(char(0xF0 - 0x80)));
+    const __m128i mustContinue = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80)));
+    return _mm_xor_si128(mustContinue, special);
+}
+
+/* Validates 64 bytes per round with the lookup tables of Keiser and
+   Lemire ("Validating UTF-8 in less than one instruction per byte"),
+   ASCII rounds included. Returns where the byte-wise check goes on:
+   the start of the first round with an error, for its exact offset,
+   or the end of the last round; moved back to the start of a sequence
+   that the round cut. ascii is cleared if a byte is not. */
+LOOKUP_TARGET static const uchar *validateRounds(const uchar *begin, const uchar *end, bool *ascii)
+{
+    /* the last three bytes of a round that need more of the next one */
+    const __m128i incompleteAbove = _mm_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, char(0xF0 - 1), char(0xE0 - 1), char(0xC0 - 1));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i previous = zero;
+    __m128i incomplete = zero;
+    const uchar *p = begin;
+    while (end - p >= 64) {
+        const __m128i *v = reinterpret_cast<const __m128i *>(p);
+        const __m128i in0 = _mm_loadu_si128(v), in1 = _mm_loadu_si128(v + 1);
+        const __m128i in2 = _mm_loadu_si128(v + 2), in3 = _mm_loadu_si128(v + 3);
+        __m128i error;
+        if (!_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(in0, in1), _mm_or_si128(in2, in3)))) {
+            error = incomplete;
+            incomplete = zero;
+        } else {
+            *ascii = false;
+            error = _mm_or_si128(_mm_or_si128(invalidBytes(in0, previous), invalidBytes(in1, in0)),
+                                 _mm_or_si128(invalidBytes(in2, in1), invalidBytes(in3, in2)));
+            incomplete = _mm_subs_epu8(in3, incompleteAbove);
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xFFFF)
+            break;
+        previous = in3;
+        p += 64;
+    }
+    return sequenceStart(begin, p);
+}
+
+static bool hasSsse3()
+{
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+#endif
+
+qint64 TextEncoding::validateUtf8(const char *data, qint64 size, bool *ascii)
+{
+    const uchar *const begin = reinterpret_cast<const uchar *>(data);
+    const uchar *const end = begin + size;
+    const uchar *p = begin;
+    const uchar *scalarEnd = p; // bytes before this are checked one by one
+    bool allAscii = true;
+
+#ifdef LOOKUP_VALIDATION
+    if (hasSsse3()) {
+        p = validateRounds(begin, end, &allAscii);
+        scalarEnd = end; // the rest is under 64 bytes, or has the error
+    }
+#endif
+
+    while (p < end) {
+#ifdef __SSE2__
+        /* ASCII is skipped 64 bytes at a time; only the rounds that
+           contain other bytes go through the byte-wise check */
+        if (p >= scalarEnd && end - p >= 64) {
+            const __m128i *v = reinterpret_cast<const __m128i *>(p);
+            __m128i bits = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)),
+                                        _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+            if (!_mm_movemask_epi8(bits)) {
+                p += 64;
+                continue;
+            }
+            scalarEnd = p + 64;
+        }
+#endif
+        if (*p < 0x80) {
+            ++p;
+            continue;
+        }
+        allAscii = false;
+        int length = sequenceLength(p, end);
+        if (length == 0) {
+            if (ascii)
+                *ascii = false;
+            return p - begin;
+        }
+        if (length < 0)
+            break; // cut by the end of the data
+        p += length;
+    }
+
+    if (ascii)
+        *ascii = allAscii;
+    return -1;
+}
+
+TextEncoding::Detection TextEncoding::detect(const char *data, qint64 size)
+{
+    TraceSpan span("io", "detectEncoding");
+    Detection result;
+    result.encoding = Utf8;
+    result.bomLength = 0;
+    result.invalidOffset = -1;
+
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    if (size >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+        result.bomLength = 3;
+    } else if (size >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+        result.encoding = Utf16LE;
+        result.bomLength = 2;
+        return result;
+    } else if (size >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+        result.encoding = Utf16BE;
+        result.bomLength = 2;
+        return result;
+    } else {
+        /* text in UTF-16 has a zero in most of the even or the odd bytes,
+           which UTF-8 and Latin-1 text never has */
+        const qint64 pairs = qMin<qint64>(size, utf16Sample) / 2;
+        qint64 evenZeros = 0, oddZeros = 0;
+        for (qint64 i = 0; i < pairs; ++i) {
+            evenZeros += p[2 * i] == 0;
+            oddZeros += p[2 * i + 1] == 0;
+        }
+        if (pairs >= 2) {
+            if (oddZeros * 10 > pairs * 3 && evenZeros * 20 < pairs) {
+                result.encoding = Utf16LE;
+                return result;
+            }
+            if (evenZeros * 10 > pairs * 3 && oddZeros * 20 < pairs) {
+                result.encoding = Utf16BE;
+                return result;
+            }
+        }
+    }
+
+    result.invalidOffset = validateUtf8(data + result.bomLength, size - result.bomLength);
+    if (result.invalidOffset >= 0) {
+        result.invalidOffset += result.bomLength;
+        result.encoding = Latin1;
+    }
+    span.arg("encoding", name(result.encoding));
+    return result;
+}
+
+static QString decodeUtf16(const char *data, int size, bool bigEndian)
+{
+    QString text(size / 2, Qt::Uninitialized);
+    QChar *out = text.data();
+    if (bigEndian == (QSysInfo::ByteOrder == QSysInfo::BigEndian)) {
+        std::memcpy(out, data, size_t(text.size()) * 2);
+    } else {
+        const uchar *p = reinterpret_cast<const uchar *>(data);
+        for (int i = 0; i < text.size(); ++i, p += 2)
+            out[i] = QChar(ushort(p[0] << 8 | p[1]));
+    }
+    return text;
+}
+
+int TextEncoding::completeLength(const char *data, int size, Encoding encoding)
+{
+    if (encoding == Latin1)
+        return size;
+    if (encoding == Utf8) {
+        for (int i = size - 1; i >= 0 && i >= size - 4; --i) {
+            const uchar c = uchar(data[i]);
+            if ((c & 0xC0) == 0x80)
+                continue;
+            int length = c < 0x80 ? 1 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+            return i + length <= size ? size : i;
+        }
+        return size;
+    }
+    /* whole code units, and no surrogate pair cut */
+    int length = size & ~1;
+    if (length >= 2) {
+        const uchar high = uchar(data[encoding == Utf16BE ? length - 2 : length - 1]);
+        if (high >= 0xD8 && high <= 0xDB)
+            length -= 2;
+    }
+    return length;
+}
+
+/* UTF-8 whose invalid bytes are escaped one by one, as decode() says. */
+static QString decodeEscaped(const char *data, int size)
+{
+    QString text;
+    text.reserve(size);
+    int pos = 0;
+    while (pos < size) {
+        const qint64 invalid = TextEncoding::validateUtf8(data + pos, size - pos);
+        const int valid = invalid >= 0 ? int(invalid)
+                                       : TextEncoding::completeLength(data + pos, size - pos, TextEncoding::Utf8);
+        text += QString::fromUtf8(data + pos, valid);
+        pos += valid;
+        if (pos < size)
+            text += QChar(ushort(0xDC00 | uchar(data[pos++])));
+    }
+    return text;
+}
+
+QString TextEncoding::decode(const char *data, int size, Encoding encoding, qint64 *invalidOffset)
+{
+    switch (encoding) {
+    case Utf8: {
+        bool ascii;
+        qint64 invalid = validateUtf8(data, size, &ascii);
+        if (invalid >= 0 && invalidOffset)
+            *invalidOffset = invalid;
+        if (invalid >= 0 || completeLength(data, size, Utf8) < size)
+            return decodeEscaped(data, size);
+        /* ASCII needs no decoding, only widening, which fromLatin1 does
+           with SIMD */
+        return ascii ? QString::fromLatin1(data, size) : QString::fromUtf8(data, size);
+    }
+    case Utf16LE:
+        return decodeUtf16(data, size, false);
+    case Utf16BE:
+        return decodeUtf16(data, size, true);
+    case Latin1:
+        break;
+    }
+    return QString::fromLatin1(data, size);
+}
+
+QByteArray TextEncoding::encode(const QString &text, Encoding encoding)
+{
+    switch (encoding) {
+    case Utf8: {
+        /* the escapes of decode() go back to the bytes they stand for */
+        const QChar *chars = text.constData();
+        QByteArray bytes;
+        int from = 0;
+        for (int i = 0; i < text.size(); ++i) {
+            const ushort u = chars[i].unicode();
+            if (u < 0xDC80 || u > 0xDCFF || (i > 0 && chars[i - 1].isHighSurrogate()))
+                continue;
+            bytes += QStringView(chars + from, i - from).toUtf8();
+            bytes += char(u & 0xFF);
+            from = i + 1;
+        }
+        if (from == 0)
+            return text.toUtf8();
+        bytes += QStringView(chars + from, text.size() - from).toUtf8();
+        return bytes;
+    }
+    case Utf16LE:
+    case Utf16BE: {
+        QByteArray bytes(text.size() * 2, Qt::Uninitialized);
+        uchar *out = reinterpret_cast<uchar *>(bytes.data());
+        for (int i = 0; i < text.size(); ++i, out += 2) {
+            ushort u = text.at(i).unicode();
+            out[encoding == Utf16BE ? 0 : 1] = uchar(u >> 8);
+            out[encoding == Utf16BE ? 1 : 0] = uchar(u);
+        }
+        return bytes;
+    }
+    case Latin1:
+        break;
+    }
+    return text.toLatin1();
+}
+
+QString TextEncoding::name(Encoding encoding)
+{
+    switch (encoding) {
+    case Utf8:
+        return QStringLiteral("UTF-8");
+    case Utf16LE:
+        return QStringLiteral("UTF-16LE");
+    case Utf16BE:
+        return QStringLiteral("UTF-16BE");
+    case Latin1:
+        break;
+    }
+    return QStringLiteral("ISO-8859-1");
+}
@@ -0,0 +1,46 @@
+#ifndef TEXTENCODING_H
+#define TEXTENCODING_H
+
+#include <QString>
+
+/* Encoding detection and decoding of file contents. Only the encodings
+   that can be told apart from the bytes alone are supported: UTF-8,
+   UTF-16 with either byte order, and Latin-1 for anything else. */
+class TextEncoding
+{
+public:
+    enum Encoding { Utf8, Utf16LE, Utf16BE, Latin1 };
+
+    struct Detection
+    {
+        Encoding encoding;
+        int bomLength;
+        qint64 invalidOffset; // first byte that is not valid UTF-8, or -1
+    };
+
+    /* Looks at the start of a file: a BOM, then the zero bytes of
+       UTF-16 text, then whether it is valid UTF-8. A sample may end
+       inside a UTF-8 sequence. */
+    static Detection detect(const char *data, qint64 size);
+
+    /* The offset of the first byte that is not part of a valid UTF-8
+       sequence, or -1. A sequence cut by the end of the data is not
+       an error. ascii is set when all bytes are below 0x80. */
+    static qint64 validateUtf8(const char *data, qint64 size, bool *ascii = nullptr);
+
+    /* Each byte of invalid UTF-8, or of a sequence cut by the end of
+       the data, is decoded to the lone surrogate U+DC80 + (byte - 0x80),
+       which encode() turns back into that byte, so a file that is not
+       quite UTF-8 is saved as it was read. The offset of the first
+       invalid byte is stored in invalidOffset, which is left alone if
+       there is none. */
+    static QString decode(const char *data, int size, Encoding encoding, qint64 *invalidOffset = nullptr);
+    static QByteArray encode(const QString &text, Encoding encoding);
+    /* The length of the longest prefix of a chunk that does not end
+       inside a character; the rest is decoded with the next chunk. */
+    static int completeLength(const char *data, int size, Encoding encoding);
+
+    static QString name(Encoding encoding);
+};
+
+#endif
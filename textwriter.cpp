@@ -0,0 +1,155 @@
+#include "textwriter.h"
+#include "trace.h"
+
+#include <QFileDevice>
+
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+static const int bufferSize = 1 << 20;
+// Smaller ranges are cheaper to copy through the buffer.
+static const qint64 minFileRange = 64 * 1024;
+
+TextWriter::TextWriter(QIODevice *device, TextEncoding::Encoding encoding, LineEndings::Style style, bool bom) :
+    device(device),
+    encoding(encoding),
+    ending(TextEncoding::encode(QString::fromLatin1(LineEndings::bytes(style)), encoding)),
+    pendingCr(false),
+    failed(false),
+    canCopyRanges(true)
+{
+    buffer.reserve(bufferSize);
+    if (bom && encoding != TextEncoding::Latin1)
+        writeText(QString(QChar(0xFEFF)));
+}
+
+void TextWriter::append(const char *data, qint64 size)
+{
+    while (size > 0) {
+        const int count = int(qMin<qint64>(size, bufferSize - buffer.size()));
+        buffer.append(data, count);
+        data += count;
+        size -= count;
+        if (buffer.size() >= bufferSize)
+            flush();
+    }
+}
+
+void TextWriter::flush()
+{
+    if (!buffer.isEmpty() && device->write(buffer) != buffer.size())
+        failed = true;
+    buffer.clear();
+}
+
+void TextWriter::writeText(const QString &text)
+{
+    const QByteArray bytes = TextEncoding::encode(text, encoding);
+    append(bytes.constData(), bytes.size());
+}
+
+void TextWriter::newline()
+{
+    append(ending.constData(), ending.size());
+}
+
+void TextWriter::writeLines(const QString &text, QChar separator)
+{
+    /* encoded in pieces, so that no copy of the whole text is made */
+    static const int piece = 64 * 1024;
+    int pos = 0;
+    while (pos < text.size()) {
+        const int nl = text.indexOf(separator, pos);
+        const int end = nl < 0 ? text.size() : nl;
+        while (pos < end) {
+            int count = qMin(end - pos, piece);
+            if (pos + count < end && text.at(pos + count - 1).isHighSurrogate())
+                --count;
+            writeText(text.mid(pos, count));
+            pos += count;
+        }
+        if (nl < 0)
+            break;
+        newline();
+        pos = nl + 1;
+    }
+}
+
+void TextWriter::convertBytes(const char *data, qint64 size)
+{
+    const char *p = data;
+    const char *const end = data + size;
+    if (pendingCr && p < end && *p == '\n')
+        ++p; // the rest of a CRLF cut by the previous call
+    pendingCr = false;
+
+    while (p < end) {
+        /* copy up to the next ending */
+        const char *q = p;
+        while (q < end && *q != '\n' && *q != '\r')
+            ++q;
+        append(p, q - p);
+        if (q == end)
+            break;
+        newline();
+        if (*q == '\r') {
+            if (q + 1 == end)
+                pendingCr = true;
+            else if (q[1] == '\n')
+                ++q;
+        }
+        p = q + 1;
+    }
+}
+
+void TextWriter::copyBytes(const char *data, qint64 size)
+{
+    pendingCr = false;
+    append(data, size);
+}
+
+void TextWriter::copyFileRange(int fd, qint64 offset, const char *data, qint64 size)
+{
+#ifdef Q_OS_LINUX
+    QFileDevice *file = qobject_cast<QFileDevice *>(device);
+    if (file && file->handle() >= 0 && fd >= 0 && size >= minFileRange && canCopyRanges && !failed) {
+        TraceSpan span("io", "copyFileRange");
+        span.arg("bytes", size);
+        flush();
+        if (!file->flush()) {
+            failed = true;
+            return;
+        }
+        /* explicit offsets, then a seek to tell QFile where the kernel
+           left off */
+        loff_t in = offset;
+        loff_t out = file->pos();
+        while (size > 0) {
+            ssize_t copied = ::copy_file_range(fd, &in, file->handle(), &out, size_t(qMin<qint64>(size, 1 << 30)), 0);
+            if (copied <= 0) {
+                canCopyRanges = false; // not supported here; copy the rest
+                break;
+            }
+            data += copied;
+            size -= copied;
+        }
+        if (!file->seek(out)) {
+            failed = true;
+            return;
+        }
+    }
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(offset);
+#endif
+    copyBytes(data, size);
+}
+
+bool TextWriter::finish()
+{
+    flush();
+    return !failed;
+}
@@ -0,0 +1,51 @@
+#ifndef TEXTWRITER_H
+#define TEXTWRITER_H
+
+#include <QByteArray>
+#include "lineendings.h"
+#include "textencoding.h"
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+/* Writes a text to a device through a fixed-size buffer, so that saving
+   never holds a second copy of the document. Line endings are written
+   in one style, whatever the text had. */
+class TextWriter
+{
+public:
+    TextWriter(QIODevice *device, TextEncoding::Encoding encoding, LineEndings::Style style, bool bom = false);
+
+    /* A piece of a line, without its ending. */
+    void writeText(const QString &text);
+    void newline();
+    /* Text whose lines are separated by separator. */
+    void writeLines(const QString &text, QChar separator = QLatin1Char('\n'));
+    /* UTF-8 or Latin-1 bytes; every CRLF, LF and lone CR in them is
+       written in the style of the writer. */
+    void convertBytes(const char *data, qint64 size);
+    /* Encoded bytes, written as they are. */
+    void copyBytes(const char *data, qint64 size);
+    /* The same bytes, which are also at offset in the file open as fd.
+       Large ranges are copied by the kernel, or shared by a reflink on
+       file systems that have them, when the device is a local file. */
+    void copyFileRange(int fd, qint64 offset, const char *data, qint64 size);
+
+    /* Flushes the buffer; returns false if any write failed. */
+    bool finish();
+
+private:
+    void append(const char *data, qint64 size);
+    void flush();
+
+    QIODevice *device;
+    TextEncoding::Encoding encoding;
+    QByteArray ending;
+    QByteArray buffer;
+    bool pendingCr;
+    bool failed;
+    bool canCopyRanges;
+};
+
+#endif
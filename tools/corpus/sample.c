@@ -0,0 +1,27 @@
+/* Multi-line comment
+ * with a NOTE and a TODO: inside it.
+ */
+#include <stdio.h>
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define LONG_MACRO(x) do { \
+        printf("%d\n", x); \
+    } while (0)
+
+// A single-line comment that ends with a back-slash \
+   continues here.
+
+typedef struct point { int x, y; } point_t;
+
+static const char *names[] = { "alpha", "be\"ta", "gam\\ma", 'c' };
+
+int main(int argc, char **argv)
+{
+    unsigned long big = 0xFFul + 017 + 0b101 + 1.5e-3f;
+    char c = '\'';
+    char bad = 'ab';
+    if (argc > 1 && argv[1][0] == '-')
+        return MAX(argc, 2);
+    for (int i = 0; i < 10; ++i) { /* inline */ big += i; }
+    printf("%s: %lu\n", "result", big); // trailing
+    return TRUE;
+}
@@ -0,0 +1,23 @@
+# CMake sample
+cmake_minimum_required(VERSION 3.10)
+project(demo VERSION 1.2.3 LANGUAGES CXX)
+
+set(SOURCES main.cpp "file with spaces.cpp")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wall")
+
+#[[ Bracket comment
+    over lines ]]
+set(raw [=[ bracket argument with ]] inside ]=])
+
+if(NOT DEFINED ENV{HOME} OR WIN32)
+    message(STATUS "No home: $ENV{USER}")
+elseif(CMAKE_BUILD_TYPE STREQUAL "Debug")
+    add_definitions(-DDEBUG)
+endif()
+
+foreach(src IN LISTS SOURCES)
+    message("${src}") # trailing comment
+endforeach()
+
+add_executable(demo ${SOURCES})
+target_link_libraries(demo PRIVATE $<$<CONFIG:Debug>:debuglib>)
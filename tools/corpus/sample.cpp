@@ -0,0 +1,39 @@
+// Copyright line with a URL: https://example.org/path?a=1&b=2
+#include <QString>
+#include <vector>
+
+namespace demo {
+
+template <typename T>
+class Box : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Box(T value) : value_(value) {}
+    ~Box() override = default;
+
+    T value() const noexcept { return value_; }
+
+signals:
+    void changed(const T &v);
+
+private:
+    T value_;
+};
+
+const char *raw = R"delim(raw "string" with )" inside
+spanning lines)delim";
+
+auto lambda = [](int a, int b) -> int { return a * b; };
+
+} // namespace demo
+
+int main()
+{
+    std::vector<int> v{1, 2, 3};
+    static_cast<void>(v.size());
+    QString s = QStringLiteral("text %1").arg(3.14);
+    /* FIXME: multi-line
+       comment */ int after = 0x1p-3;
+    return nullptr == nullptr ? 0 : after;
+}
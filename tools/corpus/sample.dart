@@ -0,0 +1,28 @@
+// Dart sample
+import 'dart:math' as math;
+
+/// Doc comment
+class Point {
+  final double x, y;
+  const Point(this.x, this.y);
+
+  double distanceTo(Point other) {
+    var dx = x - other.x;
+    var dy = y - other.y;
+    return math.sqrt(dx * dx + dy * dy);
+  }
+
+  @override
+  String toString() => 'Point($x, ${y.toStringAsFixed(2)})';
+}
+
+void main() async {
+  final raw = r'raw $string';
+  final multi = """
+Multi-line "string"
+""";
+  /* block */
+  var p = Point(1.5, 2e3);
+  print("$p $raw $multi ${p.distanceTo(const Point(0, 0))}");
+  await Future.delayed(Duration(milliseconds: 10));
+}
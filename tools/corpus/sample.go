@@ -0,0 +1,30 @@
+// Go sample
+package main
+
+import (
+	"fmt"
+	"strings"
+)
+
+/* Block comment */
+
+type Shape interface {
+	Area() float64
+}
+
+type Rect struct{ W, H float64 }
+
+func (r Rect) Area() float64 { return r.W * r.H }
+
+func main() {
+	raw := `raw string
+with "quotes" and \n no escapes`
+	r := 'x'
+	n := 0x1F + 0o17 + 1e3
+	var shapes []Shape = []Shape{Rect{2, 3}}
+	for i, s := range shapes {
+		fmt.Printf("%d: %.2f %s %c %v\n", i, s.Area(), strings.ToUpper(raw), r, n)
+	}
+	defer func() { recover() }()
+	go func(ch chan<- int) { ch <- 1 }(make(chan int, 1))
+}
@@ -0,0 +1,31 @@
+package org.example;
+
+import java.util.List;
+
+/**
+ * Javadoc comment with {@link List} and @param tags.
+ * @author someone
+ */
+public final class Sample<T extends Comparable<T>> implements Runnable {
+    private static final long BIG = 0x7fff_ffffL;
+    private final char quote = '\'';
+    private final String text = "escaped \"quote\"";
+    private final String block = """
+        Text block with "quotes"
+        over lines
+        """;
+
+    @Override
+    public void run() {
+        // single-line comment
+        for (int i = 0; i < 10; i++) {
+            if (i % 2 == 0) continue; /* inline */
+            System.out.println(text + i + 1.5e-3f);
+        }
+        List<String> list = List.of("a", "b");
+        list.forEach(s -> System.out.println(s));
+    }
+
+    @SuppressWarnings("unchecked")
+    public static <U> U cast(Object o) { return (U) o; }
+}
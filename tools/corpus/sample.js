@@ -0,0 +1,29 @@
+// JavaScript sample
+'use strict';
+
+/* Block comment
+   over lines */
+const re = /ab+c\/d[/]e/gi;
+const notRegex = a / b / c;
+const tpl = `Template ${value + `nested ${deep}`} literal
+spanning lines`;
+
+class Widget extends Base {
+    constructor(name = 'widget') {
+        super();
+        this.name = name;
+    }
+
+    async load(url) {
+        const res = await fetch(url, { method: "GET" });
+        return res.ok ? res.json() : null;
+    }
+}
+
+function split(text) {
+    return text.split(/\s+/).filter(w => w.length > 0);
+}
+
+const obj = { key: "value", 'other': 0x1f, n: 1.5e3 };
+if (obj.key === "value" && !/^x/.test(obj.other)) console.log(`ok`);
+export default Widget;
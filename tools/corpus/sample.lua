@@ -0,0 +1,26 @@
+-- Lua sample
+--[[ Multi-line
+     comment ]]
+--[==[ Level-2 comment with ]] inside ]==]
+
+local M = {}
+
+local long = [[
+A long string
+with "quotes" and 'apostrophes'
+]]
+
+local level = [=[ contains ]] but continues ]=]
+
+function M.greet(name, ...)
+  local args = {...}
+  if name == nil then
+    return "anonymous" .. #args
+  elseif type(name) ~= "string" then
+    error('bad name: ' .. tostring(name))
+  end
+  for i, v in ipairs(args) do print(i, v) end
+  return string.format("Hello, %s! %d", name, 0x1F)
+end
+
+return M
@@ -0,0 +1,28 @@
+# Makefile sample
+CC ?= gcc
+CFLAGS := -O2 -Wall
+SOURCES = $(wildcard src/*.c)
+OBJECTS = $(SOURCES:.c=.o)
+
+.PHONY: all clean
+
+all: app
+
+app: $(OBJECTS)
+	$(CC) $(CFLAGS) -o $@ $^ $(LDFLAGS)
+
+%.o: %.c
+	@echo "compiling $<"
+	$(CC) $(CFLAGS) -c $< -o $@
+
+ifeq ($(DEBUG),1)
+CFLAGS += -g
+endif
+
+define HELP
+Multi-line variable
+with $(CC)
+endef
+
+clean:
+	rm -f $(OBJECTS) app # remove
@@ -0,0 +1,32 @@
+program Sample;
+{ Pascal sample
+  with a brace comment }
+(* Another
+   comment style *)
+
+uses SysUtils;
+
+const
+  Max = $FF;
+  Name = 'It''s a string';
+
+type
+  TPoint = record
+    X, Y: Integer;
+  end;
+
+var
+  P: TPoint;
+  I: Integer;
+
+function Sum(A, B: Integer): Integer;
+begin
+  Result := A + B; // line comment
+end;
+
+begin
+  P.X := 1; P.Y := 2;
+  for I := 0 to Max do
+    if I mod 2 = 0 then
+      WriteLn(Format('%d %s', [Sum(I, P.X), Name]));
+end.
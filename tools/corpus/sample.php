@@ -0,0 +1,35 @@
+<?php
+// PHP sample
+namespace App;
+
+/* Block comment */
+# Hash comment
+
+class User
+{
+    private string $name;
+    const LIMIT = 0x10;
+
+    public function __construct(string $name = 'guest')
+    {
+        $this->name = $name;
+    }
+
+    public function greet(): string
+    {
+        return "Hello, {$this->name}! \$escaped";
+    }
+}
+
+$users = ['alice' => new User("alice"), 'bob' => new User()];
+foreach ($users as $key => $user) {
+    echo $user->greet() . PHP_EOL;
+}
+
+$text = <<<EOT
+Heredoc with $key
+EOT;
+$raw = <<<'EOT'
+Nowdoc without $vars
+EOT;
+?>
@@ -0,0 +1,43 @@
+#!/usr/bin/perl
+use strict;
+use warnings;
+
+# Quoting operators with various delimiters
+my $a = q{single {nested} braces};
+my $b = qq(double (nested) with $a);
+my @w = qw/one two three/;
+my $re = qr{^\s*(\w+)\s*=\s*(.*)$}x;
+my $cmd = qx[ls -l];
+
+my $text = "line";
+$text =~ s/foo/bar/g;
+$text =~ s{foo}
+          {bar}gx;
+$text =~ tr/a-z/A-Z/;
+$text =~ y#abc#xyz#;
+if ($text =~ m!^LINE$!i) { print "matched\n"; }
+my $div = 10 / 2 / 5;
+
+my %h = (key => 'value', "other" => 42);
+print <<"END";
+Here-doc with $text and @{[ scalar @w ]}
+END
+
+print <<'RAW';
+No $interpolation here
+RAW
+
+my $multi = "a string
+that spans lines";
+
+=pod
+
+POD documentation block.
+
+=cut
+
+sub greet { my ($who) = @_; return "Hello, $who"; }
+print greet("perl"), "\n";
+
+__DATA__
+raw data $not highlighted
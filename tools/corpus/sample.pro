@@ -0,0 +1,17 @@
+# qmake sample
+TEMPLATE = app
+TARGET = sample
+QT += widgets network
+CONFIG += c++11
+
+SOURCES += main.cpp \
+           window.cpp
+HEADERS += window.h
+
+unix:!macx {
+    LIBS += -lz
+    target.path = $$PREFIX/bin
+    INSTALLS += target
+}
+
+message("Building $$TARGET with $$QT_VERSION")
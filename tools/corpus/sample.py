@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+"""Module docstring
+spanning several lines."""
+
+import os
+from typing import List
+
+CONSTANT = 0x1F + 0b1010 + 1.5e-3
+
+
+class Shape(object):
+    '''Single-quoted
+    docstring'''
+
+    def __init__(self, name: str, sides: int = 3) -> None:
+        self.name = name  # trailing comment
+        self.sides = sides
+
+    @property
+    def label(self):
+        return f"{self.name} has {self.sides} sides"
+
+
+def walk(path: str) -> List[str]:
+    result = []
+    for root, dirs, files in os.walk(path):
+        result.extend(os.path.join(root, f) for f in files if not f.startswith('.'))
+    return result
+
+
+raw = r"C:\path\no\escapes"
+byte = b'\x00\xff'
+text = "escaped \" quote" + 'and \' this'
+if __name__ == "__main__":
+    print(walk("."), lambda x: x ** 2)
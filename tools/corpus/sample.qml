@@ -0,0 +1,28 @@
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+
+/* QML sample */
+ApplicationWindow {
+    id: window
+    width: 640; height: 480
+    visible: true
+    title: qsTr("Hello %1").arg("QML")
+
+    property int count: 0
+    property var pattern: /^[a-z]+$/i
+    signal clicked(string name)
+
+    Rectangle {
+        anchors.fill: parent
+        color: count > 3 ? "red" : 'green'
+        // a comment
+        MouseArea {
+            anchors.fill: parent
+            onClicked: { count++; window.clicked(`item ${count}`) }
+        }
+    }
+
+    function check(text) {
+        return pattern.test(text) && text.length / 2 > 1
+    }
+}
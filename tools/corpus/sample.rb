@@ -0,0 +1,37 @@
+# Ruby sample
+require 'json'
+
+module Demo
+  class Greeter
+    attr_reader :name
+
+    def initialize(name = "world")
+      @name = name
+      @@count ||= 0
+      $global = :symbol
+    end
+
+    def greet
+      puts "Hello, #{@name}!"
+      puts 'No #{interpolation}'
+      %w[one two three].each { |w| puts w }
+      text = %q(single (nested) quote)
+      other = %Q{double #{text}}
+      regex = /\A[a-z]+\z/i
+      regex2 = %r{^/path/(\d+)$}
+      puts "match" if name =~ regex
+    end
+  end
+end
+
+doc = <<~HEREDOC
+  Squiggly here-doc with #{1 + 2}
+    indented line
+HEREDOC
+
+=begin
+Block comment
+spanning lines
+=end
+
+Demo::Greeter.new("ruby").greet
@@ -0,0 +1,32 @@
+// Rust sample
+//! Inner doc comment
+/// Outer doc comment
+use std::collections::HashMap;
+
+/* Block comment /* nested */ still comment */
+
+#[derive(Debug, Clone)]
+pub struct Point<'a> {
+    x: i32,
+    name: &'a str,
+}
+
+impl<'a> Point<'a> {
+    pub fn new(x: i32, name: &'a str) -> Self {
+        Point { x, name }
+    }
+}
+
+fn main() {
+    let raw = r#"raw "string" with quotes"#;
+    let bytes = b"bytes\n";
+    let c = 'c';
+    let hex = 0xFF_u8 + 0o17 + 0b1010;
+    let float = 1.5e-3_f64;
+    let mut map: HashMap<&str, i32> = HashMap::new();
+    map.insert("key", 42);
+    let s = "multi
+line string";
+    println!("{:?} {} {} {}", Point::new(1, "p"), raw, c, s);
+    if let Some(v) = map.get("key") { println!("{}", v); }
+}
@@ -0,0 +1,31 @@
+#!/bin/bash
+# Comment with 'quotes' and "double quotes"
+set -euo pipefail
+
+name="world $(whoami) ${HOME:-/tmp}"
+single='no $expansion here'
+mixed="it's \"quoted\" and `date`"
+
+cat <<EOF2
+Here-doc with $name and $(echo nested "quotes")
+  indentation kept
+EOF2
+
+cat <<-'RAW'
+	No $expansion in a quoted here-doc
+	RAW
+
+if [[ -n "$1" && $# -gt 2 ]]; then
+    for f in *.txt; do
+        echo "file: ${f%.txt}" >> "$log" 2>&1
+    done
+fi
+
+result=$( (echo "sub shell"; echo 'x') | grep -c "x" )
+arr=(one "two three" 'four')
+echo "${arr[@]}" # trailing comment
+func() { local x=$((1 + 2 * 3)); echo $x; }
+case "$1" in
+    start|stop) echo "$1" ;;
+    *) exit 1 ;;
+esac
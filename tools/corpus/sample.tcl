@@ -0,0 +1,27 @@
+#!/usr/bin/env tclsh
+# Tcl sample
+package require Tcl 8.6
+
+set name "world"
+set braced {no $substitution [here]}
+set list [list a "b c" {d e}]
+
+proc greet {who {greeting "Hello"}} {
+    global name
+    puts "$greeting, $who! [string toupper $name]"
+    return ${who}_done
+}
+
+if {[llength $list] > 2} {
+    foreach item $list {
+        puts "item: $item" ;# trailing comment
+    }
+} else {
+    error "too short"
+}
+
+set multi "a quoted string
+over two lines"
+array set arr {key value other 42}
+puts $arr(key)
+greet "tcl"
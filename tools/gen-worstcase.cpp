@@ -0,0 +1,67 @@
+/* Writes a synthetic worst-case document for performance testing.
+   Usage: gen-worstcase [--seed N] [--lines N] [-o FILE] SHAPE SIZE */
+
+#include "worstcase.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+#include <cstdio>
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generates synthetic worst-case documents. Shapes: "
+                                     + WorstCaseGenerator::shapes().join(", ") + ".");
+    parser.addHelpOption();
+    QCommandLineOption seedOption("seed", "Seed of the random generator.", "n",
+                                  QString::number(WorstCaseGenerator::defaultSeed));
+    QCommandLineOption linesOption("lines", "Stop line-based shapes after <n> lines.", "n", "0");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write to <file> instead of stdout.", "file");
+    parser.addOption(seedOption);
+    parser.addOption(linesOption);
+    parser.addOption(outputOption);
+    parser.addPositionalArgument("shape", "The kind of document.");
+    parser.addPositionalArgument("size", "The size in bytes, optionally with a k, M or G suffix.");
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2)
+        parser.showHelp(1);
+
+    QTextStream err(stderr);
+    if (!WorstCaseGenerator::shapes().contains(args.at(0))) {
+        err << "Unknown shape: " << args.at(0) << "\n";
+        return 1;
+    }
+    bool ok = false;
+    qint64 size = WorstCaseGenerator::parseSize(args.at(1), &ok);
+    if (!ok) {
+        err << "Invalid size: " << args.at(1) << "\n";
+        return 1;
+    }
+
+    QFile out;
+    bool opened;
+    if (parser.isSet(outputOption)) {
+        out.setFileName(parser.value(outputOption));
+        opened = out.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    } else {
+        opened = out.open(stdout, QIODevice::WriteOnly);
+    }
+    if (!opened) {
+        err << "Cannot write " << parser.value(outputOption) << "\n";
+        return 1;
+    }
+
+    WorstCaseGenerator generator(parser.value(seedOption).toUInt());
+    if (generator.generate(args.at(0), size, parser.value(linesOption).toLongLong(), &out) < 0) {
+        err << "Write error\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+# Runs highlight-dump on the corpus and, if REFERENCE is given,
+# compares every dump with the one in the reference directory.
+#
+#   cmake -DDUMP_TOOL=<highlight-dump> -DCORPUS=<dir> -DOUTPUT=<dir>
+#         [-DREFERENCE=<dir>] -P golden-check.cmake
+
+# only the dumps, as tools/golden also holds its README
+file(GLOB stale "${OUTPUT}/*.dump")
+if(stale)
+    file(REMOVE ${stale})
+endif()
+execute_process(COMMAND "${DUMP_TOOL}" --output-dir "${OUTPUT}" "${CORPUS}"
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "highlight-dump failed (${result})")
+endif()
+
+if(NOT REFERENCE)
+    return()
+endif()
+file(GLOB dumps RELATIVE "${OUTPUT}" "${OUTPUT}/*.dump")
+file(GLOB references RELATIVE "${REFERENCE}" "${REFERENCE}/*.dump")
+if(NOT references)
+    message(FATAL_ERROR "No golden reference in ${REFERENCE}; build the golden-reference target first")
+endif()
+
+set(mismatches "")
+foreach(dump IN LISTS references)
+    if(NOT EXISTS "${OUTPUT}/${dump}")
+        list(APPEND mismatches "${dump} (missing)")
+    endif()
+endforeach()
+
+find_program(DIFF_TOOL diff)
+foreach(dump IN LISTS dumps)
+    if(NOT EXISTS "${REFERENCE}/${dump}")
+        list(APPEND mismatches "${dump} (new)")
+    else()
+        execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+                                "${REFERENCE}/${dump}" "${OUTPUT}/${dump}"
+                        RESULT_VARIABLE differs)
+        if(differs)
+            list(APPEND mismatches "${dump}")
+            if(DIFF_TOOL)
+                execute_process(COMMAND ${DIFF_TOOL} -u "${REFERENCE}/${dump}" "${OUTPUT}/${dump}")
+            endif()
+        endif()
+    endif()
+endforeach()
+
+list(LENGTH dumps count)
+if(mismatches)
+    string(REPLACE ";" "\n  " mismatches "${mismatches}")
+    message(FATAL_ERROR "Highlighter output changed:\n  ${mismatches}")
+endif()
+message(STATUS "All ${count} dumps match the golden reference")
@@ -0,0 +1,85 @@
+#include "headlessdocument.h"
+#include "highlighter/highlighter.h"
+
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QTextCursor>
+#include <QTextDocument>
+
+#include <algorithm>
+
+HeadlessDocument::HeadlessDocument(const QString &lang) :
+    lang(lang),
+    doc(new QTextDocument),
+    hl(nullptr),
+    passQueued(false)
+{
+}
+
+HeadlessDocument::~HeadlessDocument()
+{
+    delete hl;
+    delete doc;
+}
+
+void HeadlessDocument::usePlatform()
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+}
+
+void HeadlessDocument::setText(const QString &text)
+{
+    /* The highlighter is recreated so that its limits cover the new
+       text and loading it is not mixed up with highlighting it. */
+    delete hl;
+    hl = nullptr;
+    doc->setPlainText(text);
+
+    QTextCursor end(doc);
+    end.movePosition(QTextCursor::End);
+    hl = new Highlighter(doc, lang, QTextCursor(doc), end, false, false, false, 180);
+    passQueued = true;
+}
+
+void HeadlessDocument::highlight()
+{
+    if (!hl)
+        return;
+    /* A new highlighter has a full pass queued by setDocument(); calling
+       rehighlight() as well would highlight everything twice. */
+    if (!passQueued)
+        hl->rehighlight();
+    passQueued = false;
+    /* That pass, and the queued calls with which some languages update
+       the next block. */
+    QCoreApplication::sendPostedEvents(hl, QEvent::MetaCall);
+}
+
+QStringList collectCorpusFiles(const QStringList &paths)
+{
+    QStringList files;
+    for (const QString &path : paths) {
+        if (QFileInfo(path).isDir()) {
+            QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+            QStringList dirFiles;
+            while (it.hasNext())
+                dirFiles << it.next();
+            dirFiles.sort();
+            files << dirFiles;
+        } else {
+            files << path;
+        }
+    }
+    return files;
+}
+
+qint64 percentile(QVector<qint64> values, double p)
+{
+    if (values.isEmpty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    int index = qBound(0, int(p * (values.size() - 1) + 0.5), values.size() - 1);
+    return values.at(index);
+}
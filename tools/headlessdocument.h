@@ -0,0 +1,48 @@
+#ifndef HEADLESSDOCUMENT_H
+#define HEADLESSDOCUMENT_H
+
+#include <QStringList>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+QT_END_NAMESPACE
+
+class Highlighter;
+
+/* A QTextDocument and its Highlighter without any view. The whole
+   document is treated as visible, so every block gets its complete
+   formatting, exactly as it would inside the editor. */
+class HeadlessDocument
+{
+public:
+    HeadlessDocument(const QString &lang);
+    ~HeadlessDocument();
+
+    /* Must be called before the QGuiApplication is created. */
+    static void usePlatform();
+
+    QString language() const { return lang; }
+    QTextDocument *document() const { return doc; }
+    Highlighter *highlighter() const { return hl; }
+
+    /* Replaces the text; the new text is not highlighted yet. */
+    void setText(const QString &text);
+    /* Highlights the whole document synchronously, including the
+       blocks that the highlighter queues for a later update. */
+    void highlight();
+
+private:
+    QString lang;
+    QTextDocument *doc;
+    Highlighter *hl;
+    bool passQueued; // the full pass setDocument() queues, not done yet
+};
+
+/* Expands directories (recursively, sorted) into the files they contain. */
+QStringList collectCorpusFiles(const QStringList &paths);
+
+/* Returns the value at fraction p (0 to 1) of the sorted values. */
+qint64 percentile(QVector<qint64> values, double p);
+
+#endif
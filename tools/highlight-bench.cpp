@@ -0,0 +1,145 @@
+/* Measures how fast the highlighter formats whole documents.
+   Usage: highlight-bench [--lang LANG] [--repeat N] [--synthetic SHAPE[:SIZE]]... [FILE|DIR...] */
+
+#include "headlessdocument.h"
+#include "worstcase.h"
+#include "highlighter/highlighter.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QMap>
+#include <QTextDocument>
+#include <QTextStream>
+
+struct BenchResult
+{
+    qint64 bytes = 0;
+    qint64 lines = 0;
+    qint64 loadNs = 0;
+    qint64 highlightNs = 0;
+};
+
+/* The fastest of several runs is kept, as it is the least disturbed one. */
+static BenchResult benchText(const QString &lang, const QString &text, int repeat)
+{
+    BenchResult best;
+    for (int i = 0; i < repeat; ++i) {
+        HeadlessDocument doc(lang);
+        QElapsedTimer timer;
+
+        timer.start();
+        doc.setText(text);
+        qint64 loadNs = timer.nsecsElapsed();
+
+        timer.restart();
+        doc.highlight();
+        qint64 highlightNs = timer.nsecsElapsed();
+
+        if (i == 0 || highlightNs < best.highlightNs) {
+            best.highlightNs = highlightNs;
+            best.loadNs = loadNs;
+        }
+        best.lines = doc.document()->blockCount();
+    }
+    best.bytes = text.toUtf8().size();
+    return best;
+}
+
+static QString formatRow(const QString &lang, const QString &name, const BenchResult &r)
+{
+    double seconds = r.highlightNs / 1e9;
+    double mbps = seconds > 0 ? (r.bytes / (1024.0 * 1024.0)) / seconds : 0;
+    double nsPerLine = r.lines > 0 ? double(r.highlightNs) / r.lines : 0;
+    return QString("%1 %2 %3 %4 %5 %6 %7")
+            .arg(lang, -12)
+            .arg(name, -32)
+            .arg(r.bytes, 12)
+            .arg(r.lines, 9)
+            .arg(r.loadNs / 1e6, 10, 'f', 2)
+            .arg(mbps, 9, 'f', 2)
+            .arg(nsPerLine, 10, 'f', 0);
+}
+
+int main(int argc, char **argv)
+{
+    HeadlessDocument::usePlatform();
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the syntax highlighter without a window.");
+    parser.addHelpOption();
+    QCommandLineOption langOption("lang", "Highlight every file as <lang> instead of guessing it.", "lang");
+    QCommandLineOption repeatOption("repeat", "Highlight each file <n> times and keep the fastest run.", "n", "3");
+    QCommandLineOption syntheticOption("synthetic", "Also highlight a generated document of <shape> ("
+                                       + WorstCaseGenerator::shapes().join(", ")
+                                       + "), 1M by default. Can be repeated.", "shape[:size]");
+    parser.addOption(langOption);
+    parser.addOption(repeatOption);
+    parser.addOption(syntheticOption);
+    parser.addPositionalArgument("paths", "Files or directories of the corpus.", "[FILE|DIR...]");
+    parser.process(app);
+
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+    QStringList files = collectCorpusFiles(parser.positionalArguments());
+    const QStringList synthetics = parser.values(syntheticOption);
+    if (files.isEmpty() && synthetics.isEmpty())
+        parser.showHelp(1);
+
+    QTextStream out(stdout);
+    out << QString("%1 %2 %3 %4 %5 %6 %7")
+           .arg("language", -12).arg("file", -32).arg("bytes", 12).arg("lines", 9)
+           .arg("load ms", 10).arg("MB/s", 9).arg("ns/line", 10) << "\n";
+
+    QMap<QString, BenchResult> totals;
+    for (const QString &synthetic : synthetics) {
+        QString shape = synthetic.section(':', 0, 0);
+        QString lang = WorstCaseGenerator::language(shape);
+        bool ok = true;
+        qint64 size = synthetic.contains(':')
+                      ? WorstCaseGenerator::parseSize(synthetic.section(':', 1), &ok)
+                      : Q_INT64_C(1) << 20;
+        if (lang.isEmpty() || !ok) {
+            QTextStream(stderr) << "Invalid synthetic document: " << synthetic << "\n";
+            return 1;
+        }
+
+        WorstCaseGenerator generator;
+        QString text = QString::fromUtf8(generator.generate(shape, size));
+        BenchResult r = benchText(lang, text, repeat);
+        out << formatRow(lang, synthetic, r) << "\n";
+        out.flush();
+    }
+
+    for (const QString &path : files) {
+        QString lang = parser.isSet(langOption) ? parser.value(langOption)
+                                                : Highlighter::languageForFile(path);
+        if (lang.isEmpty())
+            continue;
+
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            QTextStream(stderr) << "Cannot open " << path << "\n";
+            continue;
+        }
+        QString text = QString::fromUtf8(file.readAll());
+
+        BenchResult r = benchText(lang, text, repeat);
+        out << formatRow(lang, QFileInfo(path).fileName(), r) << "\n";
+        out.flush();
+
+        BenchResult &t = totals[lang];
+        t.bytes += r.bytes;
+        t.lines += r.lines;
+        t.loadNs += r.loadNs;
+        t.highlightNs += r.highlightNs;
+    }
+
+    out << "\n";
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it)
+        out << formatRow(it.key(), "(all files)", it.value()) << "\n";
+
+    return 0;
+}
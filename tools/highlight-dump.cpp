@@ -0,0 +1,137 @@
+/* Dumps the highlighting of files in a canonical text form, so that
+   the output of two builds can be compared byte by byte.
+   Usage: highlight-dump [--lang LANG] [--output-dir DIR] FILE|DIR...
+
+   Each block gives one line:
+     <block> s=<state> n=<open nests> p=<property> l=<label> | <start>+<length> <class> | ...
+   where <class> describes the character format of the run. */
+
+#include "headlessdocument.h"
+#include "highlighter/highlighter.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QTextStream>
+
+static QString formatClass(const QTextCharFormat &format)
+{
+    QStringList parts;
+    if (format.hasProperty(QTextFormat::ForegroundBrush))
+        parts << "fg" + format.foreground().color().name(QColor::HexArgb);
+    if (format.hasProperty(QTextFormat::BackgroundBrush))
+        parts << "bg" + format.background().color().name(QColor::HexArgb);
+    if (format.hasProperty(QTextFormat::FontWeight))
+        parts << "w" + QString::number(format.fontWeight());
+    if (format.fontItalic())
+        parts << "italic";
+    if (format.fontUnderline())
+        parts << "underline";
+    if (format.fontStrikeOut())
+        parts << "strike";
+    if (format.fontOverline())
+        parts << "overline";
+    return parts.isEmpty() ? QString("plain") : parts.join(',');
+}
+
+static void dumpDocument(const HeadlessDocument &doc, const QString &name, QTextStream &out)
+{
+    out << "# " << doc.language() << " " << name << "\n";
+    for (QTextBlock block = doc.document()->begin(); block.isValid(); block = block.next()) {
+        out << block.blockNumber() << " s=" << block.userState();
+        if (TextBlockData *data = static_cast<TextBlockData *>(block.userData())) {
+            out << " n=" << data->openNests()
+                << " p=" << int(data->getProperty())
+                << " l=" << data->labelInfo();
+        }
+
+        /* merge adjacent runs of the same class, so that the dump does
+           not depend on how the highlighter happened to split them */
+        int runStart = 0, runLength = 0;
+        QString runClass;
+        const auto ranges = block.layout()->formats();
+        for (const QTextLayout::FormatRange &range : ranges) {
+            QString cls = formatClass(range.format);
+            if (runLength > 0 && cls == runClass && range.start == runStart + runLength) {
+                runLength += range.length;
+                continue;
+            }
+            if (runLength > 0)
+                out << " | " << runStart << "+" << runLength << " " << runClass;
+            runStart = range.start;
+            runLength = range.length;
+            runClass = cls;
+        }
+        if (runLength > 0)
+            out << " | " << runStart << "+" << runLength << " " << runClass;
+        out << "\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    HeadlessDocument::usePlatform();
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Dumps the token classes and block states of the highlighter.");
+    parser.addHelpOption();
+    QCommandLineOption langOption("lang", "Highlight every file as <lang> instead of guessing it.", "lang");
+    QCommandLineOption outputOption("output-dir", "Write <file>.dump files into <dir> instead of stdout.", "dir");
+    parser.addOption(langOption);
+    parser.addOption(outputOption);
+    parser.addPositionalArgument("paths", "Files or directories of the corpus.", "FILE|DIR...");
+    parser.process(app);
+
+    QStringList files = collectCorpusFiles(parser.positionalArguments());
+    if (files.isEmpty())
+        parser.showHelp(1);
+
+    QString outputDir = parser.value(outputOption);
+    if (!outputDir.isEmpty() && !QDir().mkpath(outputDir)) {
+        QTextStream(stderr) << "Cannot create " << outputDir << "\n";
+        return 1;
+    }
+
+    QTextStream stdoutStream(stdout);
+    int status = 0;
+    for (const QString &path : files) {
+        QString lang = parser.isSet(langOption) ? parser.value(langOption)
+                                                : Highlighter::languageForFile(path);
+        if (lang.isEmpty())
+            continue;
+
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            QTextStream(stderr) << "Cannot open " << path << "\n";
+            status = 1;
+            continue;
+        }
+
+        HeadlessDocument doc(lang);
+        doc.setText(QString::fromUtf8(file.readAll()));
+        doc.highlight();
+
+        QString name = QFileInfo(path).fileName();
+        if (outputDir.isEmpty()) {
+            dumpDocument(doc, name, stdoutStream);
+            continue;
+        }
+
+        QFile dumpFile(QDir(outputDir).filePath(name + ".dump"));
+        if (!dumpFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream(stderr) << "Cannot write " << dumpFile.fileName() << "\n";
+            status = 1;
+            continue;
+        }
+        QTextStream out(&dumpFile);
+        dumpDocument(doc, name, out);
+    }
+
+    return status;
+}
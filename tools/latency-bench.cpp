@@ -0,0 +1,229 @@
+/* Measures the time from a keystroke or a paste to the end of the
+   repaint that shows it, in a CodeEditor on the offscreen platform.
+   Usage: latency-bench [--lines 1000,100000,1000000] [--shapes log,perl,yaml]
+                        [--keystrokes N] [--file FILE]... */
+
+#include "codeeditor.h"
+#include "headlessdocument.h"
+#include "worstcase.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextStream>
+
+/* Notices the paint events of the viewport. As the filter sees them
+   before they are handled, a paint is complete once the event loop
+   returns after the flag is set. */
+class PaintWatcher : public QObject
+{
+public:
+    bool painted = false;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::Paint)
+            painted = true;
+        return QObject::eventFilter(watched, event);
+    }
+};
+
+struct Sample
+{
+    QString action;
+    QVector<qint64> ns;
+    int timeouts = 0; // inputs not repainted within a second, not in ns
+
+    void add(qint64 time)
+    {
+        if (time < 0)
+            ++timeouts;
+        else
+            ns << time;
+    }
+};
+
+/* Runs `input` and waits for the repaint that follows it; -1 when none
+   comes within a second. */
+template <typename Input>
+static qint64 timeToPaint(PaintWatcher *watcher, Input input)
+{
+    QElapsedTimer timer;
+    watcher->painted = false;
+    timer.start();
+    input();
+    QElapsedTimer timeout;
+    timeout.start();
+    while (!watcher->painted) {
+        if (timeout.elapsed() >= 1000)
+            return -1;
+        QCoreApplication::processEvents();
+    }
+    return timer.nsecsElapsed();
+}
+
+static void settle()
+{
+    for (int i = 0; i < 3; ++i)
+        QCoreApplication::processEvents();
+}
+
+static void moveTo(CodeEditor *editor, int blockNumber)
+{
+    QTextBlock block = editor->document()->findBlockByNumber(blockNumber);
+    QTextCursor cursor(block);
+    cursor.movePosition(QTextCursor::EndOfBlock);
+    editor->setTextCursor(cursor);
+    editor->ensureCursorVisible();
+    settle();
+}
+
+static void sendKey(QWidget *target, int key, const QString &text)
+{
+    QKeyEvent press(QEvent::KeyPress, key, Qt::NoModifier, text);
+    QCoreApplication::sendEvent(target, &press);
+    QKeyEvent release(QEvent::KeyRelease, key, Qt::NoModifier, text);
+    QCoreApplication::sendEvent(target, &release);
+}
+
+static QVector<Sample> runScript(CodeEditor *editor, PaintWatcher *watcher, int keystrokes)
+{
+    const int blocks = editor->document()->blockCount();
+    const QList<QPair<QString, int> > positions = QList<QPair<QString, int> >()
+            << qMakePair(QString("top"), 0)
+            << qMakePair(QString("middle"), blocks / 2)
+            << qMakePair(QString("bottom"), blocks - 1);
+    const QString typed = "if (x) { y = \"z\"; } // typing ";
+
+    QString pasteText;
+    for (int i = 0; i < 50; ++i)
+        pasteText += QString("pasted line %1 with \"quotes\" and /regex/ { }\n").arg(i);
+
+    QVector<Sample> samples;
+    for (const auto &position : positions) {
+        Sample typing, enter, backspace, paste;
+        typing.action = position.first + " type";
+        enter.action = position.first + " enter";
+        backspace.action = position.first + " backspace";
+        paste.action = position.first + " paste";
+
+        moveTo(editor, position.second);
+        for (int i = 0; i < keystrokes; ++i) {
+            QString ch = typed.mid(i % typed.size(), 1);
+            typing.add(timeToPaint(watcher, [&] { sendKey(editor, ch.at(0).toUpper().unicode(), ch); }));
+        }
+        for (int i = 0; i < keystrokes; ++i)
+            backspace.add(timeToPaint(watcher, [&] { sendKey(editor, Qt::Key_Backspace, QString()); }));
+        for (int i = 0; i < qMax(1, keystrokes / 5); ++i) {
+            enter.add(timeToPaint(watcher, [&] { sendKey(editor, Qt::Key_Return, "\r"); }));
+            settle();
+            sendKey(editor, Qt::Key_Backspace, QString());
+            settle();
+        }
+        QApplication::clipboard()->setText(pasteText);
+        for (int i = 0; i < qMax(1, keystrokes / 10); ++i) {
+            paste.add(timeToPaint(watcher, [&] { editor->paste(); }));
+            settle();
+            editor->undo();
+            settle();
+        }
+        samples << typing << backspace << enter << paste;
+    }
+    return samples;
+}
+
+static void report(QTextStream &out, const QString &name, const QString &lang, int lines,
+                   const QVector<Sample> &samples)
+{
+    for (const Sample &sample : samples) {
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+               .arg(name, -20)
+               .arg(lang, -11)
+               .arg(lines, 9)
+               .arg(sample.action, -18)
+               .arg(percentile(sample.ns, 0.5) / 1e6, 9, 'f', 3)
+               .arg(percentile(sample.ns, 0.99) / 1e6, 9, 'f', 3)
+               .arg(percentile(sample.ns, 1.0) / 1e6, 9, 'f', 3)
+               .arg(sample.timeouts, 8)
+            << "\n";
+        out.flush();
+    }
+}
+
+static void benchDocument(QTextStream &out, const QString &name, const QString &lang,
+                          const QString &text, int keystrokes)
+{
+    CodeEditor editor(QFont("Monospace"));
+    editor.setLanguage(lang);
+    editor.resize(1000, 800);
+    editor.show();
+    editor.setPlainText(text);
+    settle();
+
+    PaintWatcher watcher;
+    editor.viewport()->installEventFilter(&watcher);
+    report(out, name, lang, editor.document()->blockCount(), runScript(&editor, &watcher, keystrokes));
+}
+
+int main(int argc, char **argv)
+{
+    HeadlessDocument::usePlatform();
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the keystroke-to-paint latency of the editor.");
+    parser.addHelpOption();
+    QCommandLineOption linesOption("lines", "Comma-separated document sizes in lines.", "list",
+                                   "1000,100000,1000000");
+    QCommandLineOption shapesOption("shapes", "Comma-separated generated document shapes.", "list",
+                                    "log,perl,yaml");
+    QCommandLineOption keysOption("keystrokes", "Keystrokes per position and action.", "n", "50");
+    QCommandLineOption fileOption("file", "Also measure an existing file. Can be repeated.", "file");
+    parser.addOption(linesOption);
+    parser.addOption(shapesOption);
+    parser.addOption(keysOption);
+    parser.addOption(fileOption);
+    parser.process(app);
+
+    int keystrokes = qMax(1, parser.value(keysOption).toInt());
+
+    QTextStream out(stdout);
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+           .arg("document", -20).arg("language", -11).arg("lines", 9).arg("action", -18)
+           .arg("p50 ms", 9).arg("p99 ms", 9).arg("max ms", 9).arg("timeouts", 8) << "\n";
+
+    const QStringList shapes = parser.value(shapesOption).split(',', Qt::SkipEmptyParts);
+    const QStringList sizes = parser.value(linesOption).split(',', Qt::SkipEmptyParts);
+    for (const QString &shape : shapes) {
+        QString lang = WorstCaseGenerator::language(shape);
+        if (lang.isEmpty()) {
+            QTextStream(stderr) << "Unknown shape: " << shape << "\n";
+            return 1;
+        }
+        for (const QString &size : sizes) {
+            qint64 lines = size.toLongLong();
+            WorstCaseGenerator generator;
+            /* the byte limit is only a safety net, the line count stops it */
+            QString text = QString::fromUtf8(generator.generate(shape, lines * 200, lines));
+            benchDocument(out, shape, lang, text, keystrokes);
+        }
+    }
+
+    for (const QString &path : parser.values(fileOption)) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            QTextStream(stderr) << "Cannot open " << path << "\n";
+            continue;
+        }
+        benchDocument(out, QFileInfo(path).fileName(), Highlighter::languageForFile(path),
+                      QString::fromUtf8(file.readAll()), keystrokes);
+    }
+    return 0;
+}
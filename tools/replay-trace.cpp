@@ -0,0 +1,127 @@
+/* Replays an edit trace recorded with MOUSEPAD_RECORD_TRACE on the file
+   the session started with, through a CodeEditor and its Highlighter
+   on the offscreen platform, and reports the time of each operation.
+   Usage: replay-trace [--lang LANG] [--verbose] FILE TRACE */
+
+#include "codeeditor.h"
+#include "editrecorder.h"
+#include "headlessdocument.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+
+struct OperationStats
+{
+    QVector<qint64> ns;
+    qint64 total = 0;
+};
+
+static QString operationName(const EditTraceRecord &record)
+{
+    if (record.type == EditTraceRecord::Cursor)
+        return record.anchor == record.position ? "move" : "select";
+    if (record.removed == 0)
+        return record.text.size() == 1 ? "type" : "insert";
+    return record.text.isEmpty() ? "delete" : "replace";
+}
+
+int main(int argc, char **argv)
+{
+    HeadlessDocument::usePlatform();
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a recorded edit session and times each operation.");
+    parser.addHelpOption();
+    QCommandLineOption langOption("lang", "Highlight as <lang> instead of guessing it from FILE.", "lang");
+    QCommandLineOption verboseOption("verbose", "Print the time of every operation.");
+    parser.addOption(langOption);
+    parser.addOption(verboseOption);
+    parser.addPositionalArgument("file", "The file the session started with.");
+    parser.addPositionalArgument("trace", "The recorded trace.");
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2)
+        parser.showHelp(1);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QFile file(args.at(0));
+    if (!file.open(QIODevice::ReadOnly)) {
+        err << "Cannot open " << args.at(0) << "\n";
+        return 1;
+    }
+    EditTraceReader trace(args.at(1));
+    if (!trace.isValid()) {
+        err << "Not an edit trace: " << args.at(1) << "\n";
+        return 1;
+    }
+
+    CodeEditor editor(QFont("Monospace"));
+    editor.setLanguage(parser.isSet(langOption) ? parser.value(langOption)
+                                                : Highlighter::languageForFile(args.at(0)));
+    editor.resize(1000, 800);
+    editor.show();
+    editor.setPlainText(QString::fromUtf8(file.readAll()));
+    QCoreApplication::processEvents();
+
+    QTextDocument *document = editor.document();
+    if (EditTraceReader::md5Of(document) != trace.startMd5())
+        err << "Warning: the trace was not recorded on this file, the replay may diverge\n";
+
+    QMap<QString, OperationStats> stats;
+    EditTraceRecord record;
+    int count = 0;
+    while (trace.next(record)) {
+        const int last = document->characterCount() - 1;
+        QElapsedTimer timer;
+        timer.start();
+
+        QTextCursor cursor(document);
+        if (record.type == EditTraceRecord::Edit) {
+            cursor.setPosition(qBound(0, record.position, last));
+            cursor.setPosition(qBound(0, record.position + record.removed, last), QTextCursor::KeepAnchor);
+            cursor.insertText(record.text);
+        } else {
+            cursor.setPosition(qBound(0, record.anchor, last));
+            cursor.setPosition(qBound(0, record.position, last), QTextCursor::KeepAnchor);
+            editor.setTextCursor(cursor);
+            editor.ensureCursorVisible();
+        }
+        /* the highlighter runs synchronously, the repaint is posted */
+        QCoreApplication::processEvents();
+
+        qint64 ns = timer.nsecsElapsed();
+        QString name = operationName(record);
+        OperationStats &s = stats[name];
+        s.ns << ns;
+        s.total += ns;
+        ++count;
+        if (parser.isSet(verboseOption)) {
+            out << QString("%1 %2 %3 %4\n").arg(count, 8).arg(name, -8)
+                   .arg(record.position, 10).arg(ns / 1e6, 10, 'f', 3);
+        }
+    }
+    if (!trace.isValid())
+        err << "Warning: the trace ends with a malformed record\n";
+
+    out << QString("%1 %2 %3 %4 %5 %6\n")
+           .arg("operation", -10).arg("count", 8).arg("total ms", 11)
+           .arg("p50 ms", 9).arg("p99 ms", 9).arg("max ms", 9);
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it) {
+        out << QString("%1 %2 %3 %4 %5 %6\n")
+               .arg(it.key(), -10)
+               .arg(it.value().ns.size(), 8)
+               .arg(it.value().total / 1e6, 11, 'f', 2)
+               .arg(percentile(it.value().ns, 0.5) / 1e6, 9, 'f', 3)
+               .arg(percentile(it.value().ns, 0.99) / 1e6, 9, 'f', 3)
+               .arg(percentile(it.value().ns, 1.0) / 1e6, 9, 'f', 3);
+    }
+    return 0;
+}
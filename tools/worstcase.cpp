@@ -0,0 +1,334 @@
+#include "worstcase.h"
+
+#include <QIODevice>
+
+#include <initializer_list>
+
+namespace {
+const char *const words[] = {
+    "alpha", "beta", "gamma", "delta", "epsilon", "zeta", "theta", "kappa",
+    "lambda", "sigma", "omega", "value", "item", "node", "buffer", "cursor",
+    "render", "layout", "token", "state", "block", "query", "index", "cache"
+};
+const int wordCount = sizeof(words) / sizeof(words[0]);
+
+/* Concatenates parts in order. The elements of a braced list are
+   evaluated from left to right, unlike the operands of a chain of +,
+   so the random numbers are drawn in the same order by any compiler. */
+QByteArray join(std::initializer_list<QByteArray> parts)
+{
+    QByteArray out;
+    for (const QByteArray &part : parts)
+        out += part;
+    return out;
+}
+}
+
+WorstCaseGenerator::WorstCaseGenerator(quint32 seed) :
+    rng(seed),
+    flushed(0),
+    sink(nullptr),
+    failed(false)
+{
+}
+
+QStringList WorstCaseGenerator::shapes()
+{
+    return QStringList() << "json" << "minjs" << "mincss" << "log"
+                         << "yaml" << "perl" << "svg";
+}
+
+QString WorstCaseGenerator::language(const QString &shape)
+{
+    if (shape == "minjs")
+        return "javascript";
+    if (shape == "mincss")
+        return "css";
+    if (shape == "svg")
+        return "xml";
+    return shapes().contains(shape) ? shape : QString();
+}
+
+qint64 WorstCaseGenerator::parseSize(const QString &size, bool *ok)
+{
+    QString digits = size.trimmed();
+    qint64 factor = 1;
+    if (!digits.isEmpty()) {
+        switch (digits.at(digits.size() - 1).toUpper().toLatin1()) {
+        case 'K': factor = Q_INT64_C(1) << 10; break;
+        case 'M': factor = Q_INT64_C(1) << 20; break;
+        case 'G': factor = Q_INT64_C(1) << 30; break;
+        default: break;
+        }
+        if (factor > 1)
+            digits.chop(1);
+    }
+    bool valid = false;
+    qint64 value = digits.toLongLong(&valid);
+    if (ok)
+        *ok = valid && value >= 0;
+    return valid ? value * factor : 0;
+}
+
+QByteArray WorstCaseGenerator::word()
+{
+    return words[pick(wordCount)];
+}
+
+QByteArray WorstCaseGenerator::number()
+{
+    switch (pick(4)) {
+    case 0: return QByteArray::number(pick(100000));
+    case 1: return QByteArray::number(-pick(1000));
+    case 2: return join({QByteArray::number(pick(1000)), ".", QByteArray::number(pick(1000))});
+    default: return join({QByteArray::number(pick(10)), ".5e", QByteArray::number(pick(20) - 10)});
+    }
+}
+
+QByteArray WorstCaseGenerator::generate(const QString &shape, qint64 bytes, qint64 maxLines)
+{
+    buffer.clear();
+    buffer.reserve(int(qMin<qint64>(bytes, 64 << 20)));
+    flushed = 0;
+    sink = nullptr;
+    produce(shape, bytes, maxLines);
+    QByteArray out;
+    out.swap(buffer);
+    return out;
+}
+
+qint64 WorstCaseGenerator::generate(const QString &shape, qint64 bytes, qint64 maxLines, QIODevice *device)
+{
+    buffer.clear();
+    flushed = 0;
+    sink = device;
+    failed = false;
+    produce(shape, bytes, maxLines);
+    if (!buffer.isEmpty() && device->write(buffer) != buffer.size())
+        failed = true;
+    flushed += buffer.size();
+    buffer.clear();
+    sink = nullptr;
+    return failed ? -1 : flushed;
+}
+
+void WorstCaseGenerator::put(const QByteArray &data)
+{
+    buffer += data;
+    if (sink && buffer.size() >= (1 << 20)) {
+        if (sink->write(buffer) != buffer.size())
+            failed = true;
+        flushed += buffer.size();
+        buffer.clear();
+    }
+}
+
+void WorstCaseGenerator::produce(const QString &shape, qint64 bytes, qint64 maxLines)
+{
+    if (shape == "json") {
+        /* one huge line, as written by most serializers */
+        put("[");
+        while (written() < bytes) {
+            if (written() > 1)
+                put(",");
+            put(jsonValue(0));
+        }
+        put("]\n");
+    } else if (shape == "minjs") {
+        while (written() < bytes)
+            put(jsStatement());
+        put("\n");
+    } else if (shape == "mincss") {
+        while (written() < bytes)
+            put(cssRule());
+        put("\n");
+    } else if (shape == "svg") {
+        put("<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 1000 1000\">");
+        while (written() < bytes) {
+            QByteArray fill = QByteArray::number(pick(0xffffff), 16);
+            QByteArray path = svgPathData(200 + pick(2000));
+            put("<path fill=\"#" + fill + "\" d=\"" + path + "\"/>");
+        }
+        put("</svg>\n");
+    } else if (shape == "log") {
+        for (qint64 line = 0; written() < bytes && (maxLines <= 0 || line < maxLines); ++line)
+            put(logLine(line));
+    } else if (shape == "perl") {
+        put("#!/usr/bin/perl\nuse strict;\nuse warnings;\n");
+        for (qint64 line = 3; written() < bytes && (maxLines <= 0 || line < maxLines); ++line)
+            put(perlLine());
+    } else if (shape == "yaml") {
+        /* a random walk over the nesting depth, going deep quite often */
+        int depth = 0;
+        put("---\n");
+        for (qint64 line = 1; written() < bytes && (maxLines <= 0 || line < maxLines); ++line) {
+            QByteArray indent(2 * depth, ' ');
+            switch (pick(8)) {
+            case 0:
+            case 1:
+                put(indent + word() + ":\n");
+                depth = qMin(depth + 1, 64);
+                break;
+            case 2:
+                put(join({indent, word(), ": ", number(), "\n"}));
+                break;
+            case 3:
+                put(join({indent, word(), ": {", word(), ": [", number(), ", \"", word(),
+                          "\"], ", word(), ": '", word(), "''s'}\n"}));
+                break;
+            case 4:
+                put(join({indent, word(), ": |\n", indent, "  literal ", word(), " # not a comment\n"}));
+                ++line;
+                break;
+            case 5:
+                put(join({indent, word(), ": &", word(), " \"", word(), " \\\"quoted\\\"\" # comment\n"}));
+                break;
+            case 6:
+                put(join({indent, word(), ":\n", indent, "  - ", word(), "\n", indent, "  - *", word(), "\n"}));
+                line += 2;
+                break;
+            default:
+                depth = qMax(depth - 1 - pick(3), 0);
+                put(join({QByteArray(2 * depth, ' '), word(), ": *", word(), "\n"}));
+                break;
+            }
+        }
+    }
+}
+
+QByteArray WorstCaseGenerator::jsonValue(int depth)
+{
+    int kind = depth >= 8 ? pick(4) : pick(7);
+    switch (kind) {
+    case 0: return number();
+    case 1: return join({"\"", word(), " \\\"", word(), "\\\" \\u00e9\""});
+    case 2: return chance(50) ? "true" : "null";
+    case 3: return join({"\"https://example.org/", word(), "?q=", word(), "\""});
+    case 4:
+    case 5: {
+        QByteArray obj = "{";
+        int n = 1 + pick(5);
+        for (int i = 0; i < n; ++i) {
+            if (i > 0)
+                obj += ',';
+            obj += join({"\"", word(), QByteArray::number(i), "\":", jsonValue(depth + 1)});
+        }
+        return obj + "}";
+    }
+    default: {
+        QByteArray arr = "[";
+        int n = 1 + pick(6);
+        for (int i = 0; i < n; ++i) {
+            if (i > 0)
+                arr += ',';
+            arr += jsonValue(depth + 1);
+        }
+        return arr + "]";
+    }
+    }
+}
+
+QByteArray WorstCaseGenerator::jsStatement()
+{
+    QByteArray id = join({word(), QByteArray::number(pick(1000))});
+    switch (pick(7)) {
+    case 0: return "function " + id + "(a,b){return a/b/" + number() + "}";
+    case 1: return join({"var ", id, "=/", word(), "+[/]\\/(", word(), ")?/g;"});
+    case 2: return join({"const ", id, "=`", word(), " ${", word(), "+`", word(), "`}`;"});
+    case 3: return id + "='it\\'s \"" + word() + "\"';";
+    case 4: return join({"if(", id, "<", number(), "&&", word(), ">1){", id, "++}else{", id, "--}"});
+    case 5: return id + "=" + id + ".replace(/\\s+/g,\"\").split(',').map(function(x){return x*2});";
+    default: return join({"/*", word(), "*/", id, "={", word(), ":", number(), ",\"", word(), "\":[1,2]};"});
+    }
+}
+
+QByteArray WorstCaseGenerator::cssRule()
+{
+    QByteArray selector = join({".", word(), QByteArray::number(pick(1000))});
+    switch (pick(5)) {
+    case 0:
+        return join({selector, " > a:hover,#", word(), "{color:#", QByteArray::number(pick(0xfff), 16),
+                     ";margin:0 ", QByteArray::number(pick(20)), "px}"});
+    case 1:
+        return join({selector, "{background:url(\"", word(), ".png\") no-repeat;content:\"/*", word(), "*/\"}"});
+    case 2:
+        return "@media (max-width:" + QByteArray::number(pick(2000)) + "px){" + selector
+               + "{display:none!important}}";
+    case 3:
+        return join({"/*", word(), "*/", selector, "[data-", word(), "^=\"", word(), "\"]{width:calc(100% - ",
+                     QByteArray::number(pick(100)), "px)}"});
+    default:
+        return selector + "::after{font:12px/1.5 \"" + word() + "\",sans-serif;transition:all .3s}";
+    }
+}
+
+QByteArray WorstCaseGenerator::logLine(qint64 line)
+{
+    static const char *const levels[] = {"DEBUG", "INFO", "INFO", "INFO", "WARNING", "ERROR"};
+    qint64 ms = line * 37;
+    char stamp[32];
+    qsnprintf(stamp, sizeof(stamp), "2024-01-15 %02d:%02d:%02d.%03d",
+              int(ms / 3600000 % 24), int(ms / 60000 % 60), int(ms / 1000 % 60), int(ms % 1000));
+    QByteArray out = join({stamp, " ", levels[pick(6)], " [worker-", QByteArray::number(pick(16)), "] "});
+    switch (pick(4)) {
+    case 0:
+        out += join({"Loaded /var/lib/", word(), "/", word(), ".db in ", number(), " ms"});
+        break;
+    case 1:
+        out += join({"Request to https://example.org/", word(), "?id=", QByteArray::number(pick(100000)),
+                     " returned ", QByteArray::number(200 + pick(400))});
+        break;
+    case 2:
+        out += join({"Failed to parse \"", word(), "\": unexpected '", word(), "' at line ", number()});
+        break;
+    default:
+        for (int i = pick(20); i >= 0; --i)
+            out += word() + " ";
+        break;
+    }
+    return out + "\n";
+}
+
+QByteArray WorstCaseGenerator::perlLine()
+{
+    /* balanced delimiters, including the nesting ones */
+    static const char *const delimiters[] = {"{}", "()", "[]", "<>", "//", "!!", "##", "||"};
+    const char *d = delimiters[pick(8)];
+    QByteArray open(1, d[0]), close(1, d[1]);
+    QByteArray var = "$" + word();
+    switch (pick(8)) {
+    case 0: return join({"my ", var, " = q", open, word(), " 'x' ", word(), close, ";\n"});
+    case 1: return join({"my ", var, " = qq", open, word(), " $", word(), " \"x\"", close, ";\n"});
+    case 2: return join({"my @", word(), " = qw", open, word(), " ", word(), " ", word(), close, ";\n"});
+    case 3: return join({var, " =~ s", open, word(), "\\s+", close, d[0] == d[1] ? QByteArray() : open,
+                         word(), close, "gx;\n"});
+    case 4: return var + " =~ tr" + open + "a-z" + close + (d[0] == d[1] ? QByteArray() : open) + "A-Z"
+                   + close + ";\n";
+    case 5: return "print \"match\\n\" if " + var + " =~ m" + open + "^" + word() + "(\\d+)$" + close + "i;\n";
+    case 6: return "print <<\"END\";\nhere-doc " + var + " @{[ " + word() + " ]}\nEND\n";
+    default: return join({"my ", var, " = ", number(), " / ", number(), " / 2; # ", word(), "\n"});
+    }
+}
+
+QByteArray WorstCaseGenerator::svgPathData(int segments)
+{
+    QByteArray d = join({"M", QByteArray::number(pick(1000)), ",", QByteArray::number(pick(1000))});
+    static const char commands[] = "LCQlcqHVhv";
+    for (int i = 0; i < segments; ++i) {
+        char c = commands[pick(10)];
+        d += ' ';
+        d += c;
+        int points = (c == 'C' || c == 'c') ? 3 : (c == 'Q' || c == 'q') ? 2
+                     : (c == 'H' || c == 'V' || c == 'h' || c == 'v') ? 0 : 1;
+        if (points == 0) {
+            d += QByteArray::number(pick(10000) / 10.0);
+            continue;
+        }
+        for (int p = 0; p < points; ++p) {
+            d += join({QByteArray::number(pick(10000) / 10.0), ",", QByteArray::number(pick(10000) / 10.0)});
+            if (p + 1 < points)
+                d += ' ';
+        }
+    }
+    return d + "Z";
+}
@@ -0,0 +1,63 @@
+#ifndef WORSTCASE_H
+#define WORSTCASE_H
+
+#include <QByteArray>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+#include <random>
+
+/* Generates the kinds of documents that are slow to highlight and to
+   lay out: huge single lines, millions of short lines, deep nesting.
+   With a given build, the output depends only on the shape, the size
+   and the seed. */
+class WorstCaseGenerator
+{
+public:
+    explicit WorstCaseGenerator(quint32 seed = defaultSeed);
+
+    static const quint32 defaultSeed = 20240115;
+
+    static QStringList shapes();
+    /* The highlighting language of a shape. */
+    static QString language(const QString &shape);
+    /* Parses sizes like "512", "64k", "10M" or "2G" (in bytes). */
+    static qint64 parseSize(const QString &size, bool *ok = nullptr);
+
+    /* Returns about `bytes` bytes of the given shape, or an empty
+       array if the shape is unknown. Line-based shapes stop early
+       once `maxLines` lines are written (if it is positive). */
+    QByteArray generate(const QString &shape, qint64 bytes, qint64 maxLines = 0);
+    /* Writes to `device` in chunks instead, for sizes that do not fit into
+       memory. Returns the number of bytes written or -1 on error. */
+    qint64 generate(const QString &shape, qint64 bytes, qint64 maxLines, QIODevice *device);
+
+private:
+    void put(const QByteArray &data);
+    qint64 written() const { return flushed + buffer.size(); }
+    void produce(const QString &shape, qint64 bytes, qint64 maxLines);
+
+    quint32 next() { return rng(); }
+    int pick(int n) { return int(next() % quint32(n)); }
+    bool chance(int percent) { return pick(100) < percent; }
+    QByteArray word();
+    QByteArray number();
+
+    QByteArray jsonValue(int depth);
+    QByteArray jsStatement();
+    QByteArray cssRule();
+    QByteArray logLine(qint64 line);
+    QByteArray perlLine();
+    QByteArray svgPathData(int segments);
+
+    std::mt19937 rng; // its sequence is the same with every standard library
+    QByteArray buffer;
+    qint64 flushed;
+    QIODevice *sink;
+    bool failed;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+
+#include <cstdlib>
+
+#ifdef Q_OS_UNIX
+#include <QSocketNotifier>
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct TraceEvent
+{
+    const char *category;
+    const char *name;
+    qint64 start;
+    qint64 duration;
+    quint64 thread;
+    int intCount;
+    const char *intKeys[2];
+    qint64 intValues[2];
+    const char *stringKey;
+    QString stringValue;
+};
+
+/* about 100 MB of events; the rest is counted but dropped */
+const int maxEvents = 1 << 20;
+
+QString outputFile;
+QElapsedTimer traceClock;
+QMutex mutex;
+QVector<TraceEvent> events;
+qint64 dropped = 0;
+
+#ifdef Q_OS_UNIX
+int signalPipe[2] = {-1, -1};
+
+void onSignal(int)
+{
+    char c = 1;
+    ssize_t ignored = ::write(signalPipe[0], &c, 1);
+    Q_UNUSED(ignored);
+}
+#endif
+
+void dumpAtExit()
+{
+    Trace::dump();
+}
+
+void appendJsonString(QByteArray &out, const QByteArray &utf8)
+{
+    out += '"';
+    for (char c : utf8) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (uchar(c) < 0x20) {
+            char escaped[8];
+            qsnprintf(escaped, sizeof(escaped), "\\u%04x", uchar(c));
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+bool Trace::enabled = false;
+
+void Trace::start(const QString &fileName)
+{
+    if (enabled)
+        return;
+    outputFile = fileName;
+    events.reserve(4096);
+    traceClock.start();
+    enabled = true;
+    std::atexit(dumpAtExit);
+
+#ifdef Q_OS_UNIX
+    /* The handler only wakes up the event loop, which writes the trace. */
+    if (QCoreApplication::instance() && ::socketpair(AF_UNIX, SOCK_STREAM, 0, signalPipe) == 0) {
+        QSocketNotifier *notifier = new QSocketNotifier(signalPipe[1], QSocketNotifier::Read,
+                                                        QCoreApplication::instance());
+        QObject::connect(notifier, &QSocketNotifier::activated, [] {
+            char c;
+            if (::read(signalPipe[1], &c, 1) > 0)
+                Trace::dump();
+        });
+        struct sigaction action;
+        action.sa_handler = onSignal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, nullptr);
+    }
+#endif
+}
+
+qint64 Trace::now()
+{
+    return traceClock.nsecsElapsed();
+}
+
+void Trace::record(const TraceSpan &span, qint64 end)
+{
+    TraceEvent event;
+    event.category = span.category;
+    event.name = span.name;
+    event.start = span.start;
+    event.duration = end - span.start;
+    event.thread = quint64(quintptr(QThread::currentThreadId()));
+    event.intCount = span.intCount;
+    for (int i = 0; i < span.intCount; ++i) {
+        event.intKeys[i] = span.intKeys[i];
+        event.intValues[i] = span.intValues[i];
+    }
+    event.stringKey = span.stringKey;
+    event.stringValue = span.stringValue;
+
+    QMutexLocker locker(&mutex);
+    if (events.size() < maxEvents)
+        events.append(event);
+    else
+        ++dropped;
+}
+
+bool Trace::dump()
+{
+    if (!enabled)
+        return false;
+
+    QMutexLocker locker(&mutex);
+    QFile file(outputFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Cannot write the trace to %s", qPrintable(outputFile));
+        return false;
+    }
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":"
+                     + QByteArray::number(dropped) + "},\"traceEvents\":[\n";
+    for (int i = 0; i < events.size(); ++i) {
+        const TraceEvent &e = events.at(i);
+        if (i > 0)
+            out += ",\n";
+        out += "{\"ph\":\"X\",\"name\":";
+        appendJsonString(out, e.name);
+        out += ",\"cat\":";
+        appendJsonString(out, e.category);
+        /* timestamps are in microseconds */
+        out += ",\"ts\":" + QByteArray::number(e.start / 1000.0, 'f', 3)
+               + ",\"dur\":" + QByteArray::number(e.duration / 1000.0, 'f', 3)
+               + ",\"pid\":" + pid
+               + ",\"tid\":" + QByteArray::number(e.thread);
+        if (e.intCount > 0 || e.stringKey) {
+            out += ",\"args\":{";
+            for (int a = 0; a < e.intCount; ++a) {
+                if (a > 0)
+                    out += ',';
+                appendJsonString(out, e.intKeys[a]);
+                out += ':' + QByteArray::number(e.intValues[a]);
+            }
+            if (e.stringKey) {
+                if (e.intCount > 0)
+                    out += ',';
+                appendJsonString(out, e.stringKey);
+                out += ':';
+                appendJsonString(out, e.stringValue.toUtf8());
+            }
+            out += '}';
+        }
+        out += '}';
+        if (out.size() > (1 << 20)) {
+            file.write(out);
+            out.clear();
+        }
+    }
+    out += "\n]}\n";
+    return file.write(out) == out.size() && file.flush();
+}
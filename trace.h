@@ -0,0 +1,76 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+class TraceSpan;
+
+/* Span tracing in the Chrome trace-event format (chrome://tracing,
+   Perfetto). It is compiled in but stays off unless Trace::start() is
+   called, which main() does when MOUSEPAD_TRACE names an output file.
+   The trace is written at exit and whenever the process gets SIGUSR1. */
+class Trace
+{
+public:
+    static bool isEnabled() { return enabled; }
+    static void start(const QString &fileName);
+    /* Writes everything recorded so far; returns false on error. */
+    static bool dump();
+
+private:
+    friend class TraceSpan;
+    static qint64 now();
+    static void record(const TraceSpan &span, qint64 end);
+
+    static bool enabled;
+};
+
+/* Records the time between its construction and its destruction.
+   When tracing is off, it costs a branch. */
+class TraceSpan
+{
+public:
+    TraceSpan(const char *category, const char *name) :
+        category(category),
+        name(name),
+        start(Trace::isEnabled() ? Trace::now() : -1),
+        intCount(0),
+        stringKey(nullptr)
+    {}
+    ~TraceSpan()
+    {
+        if (start >= 0)
+            Trace::record(*this, Trace::now());
+    }
+
+    bool isActive() const { return start >= 0; }
+
+    /* Arguments shown with the span; up to two numbers and a string. */
+    void arg(const char *key, qint64 value)
+    {
+        if (intCount < 2) {
+            intKeys[intCount] = key;
+            intValues[intCount++] = value;
+        }
+    }
+    void arg(const char *key, const QString &value)
+    {
+        stringKey = key;
+        stringValue = value;
+    }
+
+private:
+    friend class Trace;
+    Q_DISABLE_COPY(TraceSpan)
+
+    const char *category;
+    const char *name;
+    qint64 start;
+    int intCount;
+    const char *intKeys[2];
+    qint64 intValues[2];
+    const char *stringKey;
+    QString stringValue;
+};
+
+#endif